@@ -0,0 +1,349 @@
+#pragma once
+
+#include "astar_router.h"
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Способ выбора ориентиров ALT
+enum class LandmarkSelection {
+    FARTHEST,  // каждый следующий — вершина, дальше всех от уже выбранных
+    AVOID      // лист дерева кратчайших путей в области, где оценки хуже всего
+};
+
+// A* с нижними оценками по ориентирам (ALT). Для нескольких вершин-ориентиров
+// заранее считаются расстояния от каждой вершины до ориентира и обратно, и по
+// неравенству треугольника d(v, t) >= d(L, t) - d(L, v) и d(v, t) >= d(v, L) - d(t, L).
+// Оценка — максимум по ориентирам, лучшим для пары источник-цель. Память —
+// два массива по L * V весов, результат совпадает с поиском Дейкстры.
+// Запросы можно вызывать из нескольких потоков.
+template <typename Weight>
+class AltRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+
+    AltRouter(const Graph& graph, size_t landmark_count, LandmarkSelection selection);
+
+    AltRouter(const AltRouter&) = delete;
+    AltRouter& operator=(const AltRouter&) = delete;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    size_t GetSettledCount() const override {
+        return search_.GetSettledCount();
+    }
+
+    const std::vector<VertexId>& GetLandmarks() const {
+        return landmarks_;
+    }
+
+private:
+    // Расстояния от вершин до одного ориентира и обратно
+    struct LandmarkDistances {
+        std::vector<Weight> from_landmark;
+        std::vector<Weight> to_landmark;
+    };
+
+    void SelectFarthest(size_t landmark_count, std::vector<LandmarkDistances>& distances);
+    void SelectAvoid(size_t landmark_count, std::vector<LandmarkDistances>& distances);
+    void AddLandmark(VertexId landmark, std::vector<LandmarkDistances>& distances);
+    // Полный поиск Дейкстры из root по исходящим (по входящим при backward) дугам
+    void ComputeDistances(VertexId root, bool backward, std::vector<Weight>& distances);
+    static Weight GetLowerBound(const std::vector<LandmarkDistances>& distances,
+                                VertexId vertex, VertexId target);
+
+    // Ориентир запроса и его расстояния для цели
+    struct ActiveLandmark {
+        size_t index;
+        Weight from_landmark_to_target;
+        Weight target_to_landmark;
+    };
+    ActiveLandmark MakeActiveLandmark(size_t index, VertexId target) const;
+    Weight EstimateWeight(const std::vector<ActiveLandmark>& active_landmarks,
+                          VertexId vertex) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+    // Столько лучших для запроса ориентиров участвует в оценке: остальные
+    // редко её улучшают, а стоят на каждой релаксации
+    static constexpr size_t ACTIVE_LANDMARK_COUNT = 8;
+    static constexpr uint32_t RANDOM_SEED = 20240601;
+
+    const Graph& graph_;
+    std::vector<VertexId> landmarks_;
+    // Индекс — vertex * число ориентиров + номер ориентира: оценка для вершины
+    // читает подряд лежащие веса
+    std::vector<Weight> from_landmark_;
+    std::vector<Weight> to_landmark_;
+
+    detail::SearchState<Weight> preprocessing_state_;
+    AStarRouter<Weight> search_;
+};
+
+template <typename Weight>
+AltRouter<Weight>::AltRouter(const Graph& graph, size_t landmark_count,
+                             LandmarkSelection selection)
+    : graph_(graph)
+    , preprocessing_state_(graph.GetVertexCount())
+    , search_(graph)
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    landmark_count = std::min(landmark_count, vertex_count);
+
+    std::vector<LandmarkDistances> distances;
+    if (selection == LandmarkSelection::AVOID) {
+        SelectAvoid(landmark_count, distances);
+    } else {
+        SelectFarthest(landmark_count, distances);
+    }
+
+    const size_t stride = landmarks_.size();
+    from_landmark_.resize(vertex_count * stride);
+    to_landmark_.resize(vertex_count * stride);
+    for (size_t index = 0; index < stride; ++index) {
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            from_landmark_[vertex * stride + index] = distances[index].from_landmark[vertex];
+            to_landmark_[vertex * stride + index] = distances[index].to_landmark[vertex];
+        }
+    }
+    preprocessing_state_ = detail::SearchState<Weight>(0);
+}
+
+template <typename Weight>
+void AltRouter<Weight>::SelectFarthest(size_t landmark_count,
+                                       std::vector<LandmarkDistances>& distances) {
+    // Первый ориентир — самая дальняя от вершины 0 вершина, следующие — вершины
+    // с наибольшим расстоянием до ближайшего ориентира. Вершина, недостижимая
+    // ни из одного ориентира, выбирается раньше всех: без ориентира в её части
+    // графа оценки там нулевые
+    const size_t vertex_count = graph_.GetVertexCount();
+    std::vector<Weight> nearest(vertex_count, UNREACHABLE);
+    if (vertex_count > 0) {
+        ComputeDistances(0, false, nearest);
+    }
+    while (landmarks_.size() < landmark_count) {
+        VertexId farthest = 0;
+        for (VertexId vertex = 1; vertex < vertex_count; ++vertex) {
+            if (nearest[farthest] < nearest[vertex]) {
+                farthest = vertex;
+            }
+        }
+        AddLandmark(farthest, distances);
+        if (landmarks_.size() == 1) {
+            nearest.assign(vertex_count, UNREACHABLE);
+        }
+        const auto& from_landmark = distances.back().from_landmark;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            nearest[vertex] = std::min(nearest[vertex], from_landmark[vertex]);
+        }
+        nearest[farthest] = ZERO_WEIGHT;
+    }
+}
+
+template <typename Weight>
+void AltRouter<Weight>::SelectAvoid(size_t landmark_count,
+                                    std::vector<LandmarkDistances>& distances) {
+    // Из случайного корня r строится дерево кратчайших путей. Вес вершины —
+    // насколько оценка уже выбранных ориентиров занижает d(r, v); размер —
+    // сумма весов поддерева или 0, если в нём есть ориентир. Спуск от корня
+    // в поддерево наибольшего размера заканчивается в листе — новом ориентире
+    const size_t vertex_count = graph_.GetVertexCount();
+    // Постоянное зерно: ориентиры одного графа одинаковы от запуска к запуску
+    std::mt19937 random_engine(RANDOM_SEED);
+    DijkstraRouter<Weight> dijkstra(graph_);
+    ShortestPathTree<Weight> tree;
+    std::vector<char> is_landmark(vertex_count, false);
+    std::vector<uint32_t> child_offsets(vertex_count + 1);
+    std::vector<VertexId> children;
+    std::vector<VertexId> order;
+    std::vector<Weight> sizes(vertex_count);
+
+    while (landmarks_.size() < landmark_count) {
+        const VertexId root = static_cast<VertexId>(random_engine() % vertex_count);
+        dijkstra.BuildTree(root, tree);
+
+        // Дети каждой вершины в дереве в формате CSR
+        std::fill(child_offsets.begin(), child_offsets.end(), 0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (vertex != root && tree.IsReached(vertex)) {
+                ++child_offsets[graph_.GetEdge(tree.prev_edges[vertex]).from + 1];
+            }
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            child_offsets[vertex + 1] += child_offsets[vertex];
+        }
+        children.resize(child_offsets[vertex_count]);
+        {
+            std::vector<uint32_t> positions(child_offsets.begin(), child_offsets.end() - 1);
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                if (vertex != root && tree.IsReached(vertex)) {
+                    children[positions[graph_.GetEdge(tree.prev_edges[vertex]).from]++] = vertex;
+                }
+            }
+        }
+
+        // Обход в ширину даёт порядок, в котором дети идут после родителя
+        order.assign(1, root);
+        for (size_t i = 0; i < order.size(); ++i) {
+            const VertexId vertex = order[i];
+            order.insert(order.end(), children.begin() + child_offsets[vertex],
+                         children.begin() + child_offsets[vertex + 1]);
+        }
+        std::vector<char> has_landmark(vertex_count, false);
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            const VertexId vertex = *it;
+            Weight size = tree.weights[vertex] - GetLowerBound(distances, root, vertex);
+            has_landmark[vertex] = is_landmark[vertex];
+            for (uint32_t i = child_offsets[vertex]; i < child_offsets[vertex + 1]; ++i) {
+                has_landmark[vertex] = has_landmark[vertex] || has_landmark[children[i]];
+                size += sizes[children[i]];
+            }
+            sizes[vertex] = has_landmark[vertex] ? ZERO_WEIGHT : size;
+        }
+
+        VertexId landmark = root;
+        while (child_offsets[landmark] != child_offsets[landmark + 1]) {
+            const auto first = children.begin() + child_offsets[landmark];
+            const auto last = children.begin() + child_offsets[landmark + 1];
+            const VertexId next = *std::max_element(first, last, [&sizes](VertexId lhs, VertexId rhs) {
+                return sizes[lhs] < sizes[rhs];
+            });
+            if (!(ZERO_WEIGHT < sizes[next])) {
+                break;
+            }
+            landmark = next;
+        }
+        // Всё дерево уже покрыто ориентирами: берётся корень, если он не ориентир
+        if (is_landmark[landmark]) {
+            const auto free_vertex = std::find(is_landmark.begin(), is_landmark.end(), false);
+            landmark = static_cast<VertexId>(free_vertex - is_landmark.begin());
+        }
+        is_landmark[landmark] = true;
+        AddLandmark(landmark, distances);
+    }
+}
+
+template <typename Weight>
+void AltRouter<Weight>::AddLandmark(VertexId landmark, std::vector<LandmarkDistances>& distances) {
+    landmarks_.push_back(landmark);
+    LandmarkDistances& added = distances.emplace_back();
+    ComputeDistances(landmark, false, added.from_landmark);
+    ComputeDistances(landmark, true, added.to_landmark);
+}
+
+template <typename Weight>
+void AltRouter<Weight>::ComputeDistances(VertexId root, bool backward,
+                                         std::vector<Weight>& distances) {
+    detail::SearchState<Weight>& state = preprocessing_state_;
+    state.Start();
+    state.Relax(root, ZERO_WEIGHT, detail::SearchState<Weight>::NO_EDGE);
+    while (!state.IsQueueEmpty()) {
+        const VertexId vertex = state.PopMin();
+        const Weight weight = state.GetWeight(vertex);
+        const auto arcs = backward ? graph_.GetIncomingArcs(vertex) : graph_.GetOutgoingArcs(vertex);
+        for (const auto& arc : arcs) {
+            state.Relax(arc.vertex, weight + arc.weight, arc.edge_id);
+        }
+    }
+
+    distances.assign(graph_.GetVertexCount(), UNREACHABLE);
+    for (VertexId vertex = 0; vertex < distances.size(); ++vertex) {
+        if (state.IsReached(vertex)) {
+            distances[vertex] = state.GetWeight(vertex);
+        }
+    }
+}
+
+template <typename Weight>
+Weight AltRouter<Weight>::GetLowerBound(const std::vector<LandmarkDistances>& distances,
+                                        VertexId vertex, VertexId target) {
+    Weight bound = ZERO_WEIGHT;
+    for (const LandmarkDistances& landmark : distances) {
+        const Weight from_to_vertex = landmark.from_landmark[vertex];
+        const Weight from_to_target = landmark.from_landmark[target];
+        if (from_to_vertex != UNREACHABLE && from_to_target != UNREACHABLE) {
+            bound = std::max(bound, from_to_target - from_to_vertex);
+        }
+        const Weight vertex_to = landmark.to_landmark[vertex];
+        const Weight target_to = landmark.to_landmark[target];
+        if (vertex_to != UNREACHABLE && target_to != UNREACHABLE) {
+            bound = std::max(bound, vertex_to - target_to);
+        }
+    }
+    return bound;
+}
+
+template <typename Weight>
+typename AltRouter<Weight>::ActiveLandmark AltRouter<Weight>::MakeActiveLandmark(
+    size_t index, VertexId target) const {
+    const size_t stride = landmarks_.size();
+    return {index, from_landmark_[target * stride + index], to_landmark_[target * stride + index]};
+}
+
+template <typename Weight>
+Weight AltRouter<Weight>::EstimateWeight(const std::vector<ActiveLandmark>& active_landmarks,
+                                         VertexId vertex) const {
+    const size_t stride = landmarks_.size();
+    const Weight* from_landmark = from_landmark_.data() + vertex * stride;
+    const Weight* to_landmark = to_landmark_.data() + vertex * stride;
+    Weight bound = ZERO_WEIGHT;
+    for (const ActiveLandmark& active : active_landmarks) {
+        const Weight from_to_vertex = from_landmark[active.index];
+        if (from_to_vertex != UNREACHABLE && active.from_landmark_to_target != UNREACHABLE) {
+            bound = std::max(bound, active.from_landmark_to_target - from_to_vertex);
+        }
+        const Weight vertex_to = to_landmark[active.index];
+        if (vertex_to != UNREACHABLE && active.target_to_landmark != UNREACHABLE) {
+            bound = std::max(bound, vertex_to - active.target_to_landmark);
+        }
+    }
+    return bound;
+}
+
+template <typename Weight>
+std::optional<typename AltRouter<Weight>::RouteInfo>
+AltRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    // Для запроса выбираются ориентиры с наибольшей оценкой d(from, to)
+    const size_t stride = landmarks_.size();
+    std::vector<ActiveLandmark> active;
+    std::vector<std::pair<Weight, size_t>> ranked;
+    ranked.reserve(stride);
+    for (size_t index = 0; index < stride; ++index) {
+        active.assign(1, MakeActiveLandmark(index, to));
+        ranked.emplace_back(EstimateWeight(active, from), index);
+    }
+    const size_t active_count = std::min(ACTIVE_LANDMARK_COUNT, stride);
+    std::partial_sort(ranked.begin(), ranked.begin() + active_count, ranked.end(),
+                      [](const auto& lhs, const auto& rhs) {
+                          return lhs.first > rhs.first
+                              || (lhs.first == rhs.first && lhs.second < rhs.second);
+                      });
+    active.clear();
+    for (size_t i = 0; i < active_count; ++i) {
+        active.push_back(MakeActiveLandmark(ranked[i].second, to));
+    }
+
+    return search_.BuildRoute(from, to, [this, &active](VertexId vertex, VertexId) {
+        return EstimateWeight(active, vertex);
+    });
+}
+
+}  // namespace graph
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+#include "state_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Целенаправленный поиск A*: вершины извлекаются в порядке вес + оценка
+// оставшегося пути до цели. Оценка должна быть допустимой (не больше
+// реального веса) и согласованной, тогда результат совпадает с поиском Дейкстры.
+// Запросы можно вызывать из нескольких потоков: каждый берёт свои рабочие
+// массивы из пула.
+template <typename Weight>
+class AStarRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+    // Нижняя оценка веса пути от vertex до target
+    using Heuristic = std::function<Weight(VertexId vertex, VertexId target)>;
+
+    // Без heuristic запросы передают оценку в BuildRoute с третьим аргументом
+    explicit AStarRouter(const Graph& graph, Heuristic heuristic = {});
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Поиск с оценкой, заданной при запросе, например зависящей от цели
+    template <typename QueryHeuristic>
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to,
+                                        const QueryHeuristic& heuristic) const;
+
+    // Число вершин, извлечённых последним завершённым запросом
+    size_t GetSettledCount() const override {
+        return settled_count_;
+    }
+
+private:
+    using State = detail::SearchState<Weight>;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = State::NO_EDGE;
+
+    const Graph& graph_;
+    Heuristic heuristic_;
+    parallel::StatePool<State> states_;
+    mutable std::atomic<size_t> settled_count_ = 0;
+};
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(const Graph& graph, Heuristic heuristic)
+    : graph_(graph)
+    , heuristic_(std::move(heuristic))
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building a router");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename AStarRouter<Weight>::RouteInfo>
+AStarRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    return BuildRoute(from, to, heuristic_);
+}
+
+template <typename Weight>
+template <typename QueryHeuristic>
+std::optional<typename AStarRouter<Weight>::RouteInfo>
+AStarRouter<Weight>::BuildRoute(VertexId from, VertexId to,
+                                const QueryHeuristic& heuristic) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    const auto lease = states_.Acquire([this] {
+        return State(graph_.GetVertexCount());
+    });
+    State& state = *lease;
+    state.Start();
+    state.Relax(from, ZERO_WEIGHT, NO_EDGE, heuristic(from, to));
+
+    while (!state.IsQueueEmpty()) {
+        const VertexId vertex = state.PopMin();
+        if (vertex == to) {
+            break;
+        }
+
+        const Weight weight = state.GetWeight(vertex);
+        for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+            const Weight candidate_weight = weight + arc.weight;
+            if (!state.IsReached(arc.vertex) || candidate_weight < state.GetWeight(arc.vertex)) {
+                state.Relax(arc.vertex, candidate_weight, arc.edge_id,
+                            candidate_weight + heuristic(arc.vertex, to));
+            }
+        }
+    }
+    settled_count_ = state.GetSettledCount();
+
+    if (!state.IsReached(to)) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = state.GetPrevEdge(to); edge_id != NO_EDGE;
+         edge_id = state.GetPrevEdge(graph_.GetEdge(edge_id).from)) {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{state.GetWeight(to), std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+#include "state_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Двунаправленный поиск Дейкстры: прямой поиск из from по исходящим рёбрам
+// и обратный из to по входящим. На каждом шаге расширяется направление
+// с меньшим приоритетом в очереди; поиск завершается, когда сумма минимумов
+// обеих очередей не меньше лучшего найденного пути через общую вершину.
+// Предрасчёт не требуется. Запросы можно вызывать из нескольких потоков:
+// каждый берёт свои рабочие массивы из пула.
+template <typename Weight>
+class BidirectionalRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+
+    explicit BidirectionalRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Число вершин, извлечённых последним завершённым запросом в обоих направлениях
+    size_t GetSettledCount() const override {
+        return settled_count_;
+    }
+
+private:
+    // Состояние одного запроса
+    struct Search {
+        explicit Search(size_t vertex_count)
+            : forward(vertex_count)
+            , backward(vertex_count) {
+        }
+
+        detail::SearchState<Weight> forward;
+        detail::SearchState<Weight> backward;
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = 0;
+    };
+
+    // Извлекают ближайшую вершину направления и релаксируют её рёбра
+    void ExpandForward(Search& search) const;
+    void ExpandBackward(Search& search) const;
+    void UpdateMeeting(Search& search, VertexId vertex) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = detail::SearchState<Weight>::NO_EDGE;
+
+    const Graph& graph_;
+    parallel::StatePool<Search> searches_;
+    mutable std::atomic<size_t> settled_count_ = 0;
+};
+
+template <typename Weight>
+BidirectionalRouter<Weight>::BidirectionalRouter(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building a router");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+void BidirectionalRouter<Weight>::UpdateMeeting(Search& search, VertexId vertex) const {
+    if (!search.forward.IsReached(vertex) || !search.backward.IsReached(vertex)) {
+        return;
+    }
+    const Weight candidate = search.forward.GetWeight(vertex) + search.backward.GetWeight(vertex);
+    if (!search.best_weight || candidate < *search.best_weight) {
+        search.best_weight = candidate;
+        search.meeting_vertex = vertex;
+    }
+}
+
+template <typename Weight>
+void BidirectionalRouter<Weight>::ExpandForward(Search& search) const {
+    const VertexId vertex = search.forward.PopMin();
+    const Weight weight = search.forward.GetWeight(vertex);
+    for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+        if (search.forward.Relax(arc.vertex, weight + arc.weight, arc.edge_id)) {
+            UpdateMeeting(search, arc.vertex);
+        }
+    }
+}
+
+template <typename Weight>
+void BidirectionalRouter<Weight>::ExpandBackward(Search& search) const {
+    const VertexId vertex = search.backward.PopMin();
+    const Weight weight = search.backward.GetWeight(vertex);
+    for (const auto& arc : graph_.GetIncomingArcs(vertex)) {
+        if (search.backward.Relax(arc.vertex, weight + arc.weight, arc.edge_id)) {
+            UpdateMeeting(search, arc.vertex);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename BidirectionalRouter<Weight>::RouteInfo>
+BidirectionalRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    const auto lease = searches_.Acquire([this] {
+        return Search(graph_.GetVertexCount());
+    });
+    Search& search = *lease;
+    search.forward.Start();
+    search.backward.Start();
+    search.best_weight.reset();
+    search.forward.Relax(from, ZERO_WEIGHT, NO_EDGE);
+    search.backward.Relax(to, ZERO_WEIGHT, NO_EDGE);
+    UpdateMeeting(search, from);
+
+    while (!search.forward.IsQueueEmpty() && !search.backward.IsQueueEmpty()) {
+        const Weight forward_min = search.forward.GetMinKey();
+        const Weight backward_min = search.backward.GetMinKey();
+        if (search.best_weight && !(forward_min + backward_min < *search.best_weight)) {
+            break;
+        }
+        if (forward_min <= backward_min) {
+            ExpandForward(search);
+        } else {
+            ExpandBackward(search);
+        }
+    }
+    settled_count_ = search.forward.GetSettledCount() + search.backward.GetSettledCount();
+
+    if (!search.best_weight) {
+        return std::nullopt;
+    }
+
+    // Путь склеивается из прямой половины до точки встречи и обратной после неё
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = search.forward.GetPrevEdge(search.meeting_vertex); edge_id != NO_EDGE;
+         edge_id = search.forward.GetPrevEdge(graph_.GetEdge(edge_id).from)) {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    for (EdgeId edge_id = search.backward.GetPrevEdge(search.meeting_vertex); edge_id != NO_EDGE;
+         edge_id = search.backward.GetPrevEdge(graph_.GetEdge(edge_id).to)) {
+        edges.push_back(edge_id);
+    }
+
+    return RouteInfo{*search.best_weight, std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "flat_route_table.h"
+#include "graph.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace graph::detail {
+
+// Блочный (тайловый) Флойд–Уоршелл над FlatRouteTable. Таблица делится на
+// квадратные тайлы; для каждого блока промежуточных вершин K сначала
+// обрабатывается диагональный тайл (K, K), затем строка и столбец тайлов
+// блока K, затем все остальные тайлы — независимо друг от друга, параллельно.
+// Внутренний цикл min-plus векторизуется (AVX2 или SSE2) для весов float.
+template <typename StoredWeight>
+class BlockedFloydWarshall {
+private:
+    using Table = FlatRouteTable<StoredWeight>;
+
+public:
+    // Тайл 64 x 64: веса и рёбра трёх тайлов помещаются в L1/L2 кэш
+    static constexpr size_t TILE_SIZE = 64;
+
+    BlockedFloydWarshall(Table& table, parallel::ThreadPool& pool)
+        : table_(table)
+        , pool_(pool)
+        , vertex_count_(table.GetVertexCount())
+        , tile_count_((vertex_count_ + TILE_SIZE - 1) / TILE_SIZE) {
+    }
+
+    void Run() {
+        for (size_t through = 0; through < tile_count_; ++through) {
+            RelaxTile(through, through, through);
+
+            // Строка и столбец тайлов блока through зависят только от диагонального тайла
+            pool_.ParallelFor(2 * tile_count_, [this, through](size_t index, size_t) {
+                const size_t tile = index / 2;
+                if (tile == through) {
+                    return;
+                }
+                if (index % 2 == 0) {
+                    RelaxTile(through, tile, through);
+                } else {
+                    RelaxTile(tile, through, through);
+                }
+            });
+
+            pool_.ParallelFor(tile_count_ * tile_count_, [this, through](size_t index, size_t) {
+                const size_t row = index / tile_count_;
+                const size_t column = index % tile_count_;
+                if (row != through && column != through) {
+                    RelaxTile(row, column, through);
+                }
+            });
+        }
+    }
+
+private:
+    // Релаксирует тайл (row, column) через вершины тайла through:
+    // d[i][j] = min(d[i][j], d[i][k] + d[k][j]) для k из through по возрастанию
+    void RelaxTile(size_t row, size_t column, size_t through) {
+        const size_t row_begin = row * TILE_SIZE;
+        const size_t row_end = std::min(row_begin + TILE_SIZE, vertex_count_);
+        const size_t column_begin = column * TILE_SIZE;
+        const size_t width = std::min(column_begin + TILE_SIZE, vertex_count_) - column_begin;
+        const size_t through_begin = through * TILE_SIZE;
+        const size_t through_end = std::min(through_begin + TILE_SIZE, vertex_count_);
+
+        for (size_t vertex_through = through_begin; vertex_through < through_end; ++vertex_through) {
+            const StoredWeight* through_weights = table_.GetWeightRow(vertex_through) + column_begin;
+            const uint32_t* through_prev_edges = table_.GetPrevEdgeRow(vertex_through) + column_begin;
+
+            for (size_t vertex_from = row_begin; vertex_from < row_end; ++vertex_from) {
+                const StoredWeight weight_to_through = table_.GetWeightRow(vertex_from)[vertex_through];
+                if (weight_to_through == Table::UNREACHABLE) {
+                    continue;
+                }
+                const uint32_t prev_edge_to_through = table_.GetPrevEdgeRow(vertex_from)[vertex_through];
+                RelaxRow(table_.GetWeightRow(vertex_from) + column_begin,
+                         table_.GetPrevEdgeRow(vertex_from) + column_begin,
+                         through_weights, through_prev_edges,
+                         weight_to_through, prev_edge_to_through, width);
+            }
+        }
+    }
+
+    static void RelaxRow(StoredWeight* weights, uint32_t* prev_edges,
+                         const StoredWeight* through_weights, const uint32_t* through_prev_edges,
+                         StoredWeight weight_to_through, uint32_t prev_edge_to_through,
+                         size_t width) {
+        size_t column = 0;
+        if constexpr (std::is_same_v<StoredWeight, float>) {
+            column = RelaxRowSimd(weights, prev_edges, through_weights, through_prev_edges,
+                                  weight_to_through, prev_edge_to_through, width);
+        }
+        for (; column < width; ++column) {
+            const StoredWeight candidate_weight = weight_to_through + through_weights[column];
+            if (candidate_weight < weights[column]) {
+                weights[column] = candidate_weight;
+                prev_edges[column] = through_prev_edges[column] != Table::NO_EDGE
+                                         ? through_prev_edges[column]
+                                         : prev_edge_to_through;
+            }
+        }
+    }
+
+    // Обрабатывает префикс строки векторами; возвращает число обработанных столбцов
+    static size_t RelaxRowSimd([[maybe_unused]] float* weights,
+                               [[maybe_unused]] uint32_t* prev_edges,
+                               [[maybe_unused]] const float* through_weights,
+                               [[maybe_unused]] const uint32_t* through_prev_edges,
+                               [[maybe_unused]] float weight_to_through,
+                               [[maybe_unused]] uint32_t prev_edge_to_through,
+                               [[maybe_unused]] size_t width) {
+        size_t column = 0;
+#if defined(__AVX2__)
+        const __m256 via = _mm256_set1_ps(weight_to_through);
+        const __m256i via_edge = _mm256_set1_epi32(static_cast<int>(prev_edge_to_through));
+        const __m256i no_edge = _mm256_set1_epi32(static_cast<int>(Table::NO_EDGE));
+        for (; column + 8 <= width; column += 8) {
+            const __m256 current = _mm256_loadu_ps(weights + column);
+            const __m256 candidate = _mm256_add_ps(via, _mm256_loadu_ps(through_weights + column));
+            const __m256 is_better = _mm256_cmp_ps(candidate, current, _CMP_LT_OQ);
+            _mm256_storeu_ps(weights + column, _mm256_blendv_ps(current, candidate, is_better));
+
+            const auto* through_edges_ptr = reinterpret_cast<const __m256i*>(through_prev_edges + column);
+            auto* edges_ptr = reinterpret_cast<__m256i*>(prev_edges + column);
+            const __m256i through_edge = _mm256_loadu_si256(through_edges_ptr);
+            const __m256i candidate_edge = _mm256_blendv_epi8(
+                through_edge, via_edge, _mm256_cmpeq_epi32(through_edge, no_edge));
+            _mm256_storeu_si256(edges_ptr, _mm256_blendv_epi8(_mm256_loadu_si256(edges_ptr),
+                                                              candidate_edge,
+                                                              _mm256_castps_si256(is_better)));
+        }
+#elif defined(__SSE2__)
+        const __m128 via = _mm_set1_ps(weight_to_through);
+        const __m128i via_edge = _mm_set1_epi32(static_cast<int>(prev_edge_to_through));
+        const __m128i no_edge = _mm_set1_epi32(static_cast<int>(Table::NO_EDGE));
+        for (; column + 4 <= width; column += 4) {
+            const __m128 current = _mm_loadu_ps(weights + column);
+            const __m128 candidate = _mm_add_ps(via, _mm_loadu_ps(through_weights + column));
+            const __m128 is_better = _mm_cmplt_ps(candidate, current);
+            _mm_storeu_ps(weights + column, _mm_or_ps(_mm_and_ps(is_better, candidate),
+                                                      _mm_andnot_ps(is_better, current)));
+
+            const auto* through_edges_ptr = reinterpret_cast<const __m128i*>(through_prev_edges + column);
+            auto* edges_ptr = reinterpret_cast<__m128i*>(prev_edges + column);
+            const __m128i through_edge = _mm_loadu_si128(through_edges_ptr);
+            const __m128i no_through_edge = _mm_cmpeq_epi32(through_edge, no_edge);
+            const __m128i candidate_edge = _mm_or_si128(_mm_and_si128(no_through_edge, via_edge),
+                                                        _mm_andnot_si128(no_through_edge, through_edge));
+            const __m128i better_mask = _mm_castps_si128(is_better);
+            _mm_storeu_si128(edges_ptr, _mm_or_si128(_mm_and_si128(better_mask, candidate_edge),
+                                                     _mm_andnot_si128(better_mask,
+                                                                      _mm_loadu_si128(edges_ptr))));
+        }
+#endif
+        return column;
+    }
+
+    Table& table_;
+    parallel::ThreadPool& pool_;
+    size_t vertex_count_;
+    size_t tile_count_;
+};
+
+}  // namespace graph::detail
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cache {
+
+struct ClockCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+};
+
+// Потокобезопасный кэш на capacity записей с вытеснением по алгоритму CLOCK:
+// попадание только ставит записи бит обращения, а стрелка при вставке в полный
+// кэш снимает биты, пока не найдёт запись без обращений, и вытесняет её.
+// Каждая запись помечена версией данных: обращение с другой версией очищает кэш.
+// Value должен дёшево копироваться (например, shared_ptr на неизменяемый ответ),
+// Find возвращает копию, чтобы не держать блокировку дольше поиска.
+template <typename Key, typename Value, typename Hasher = std::hash<Key>>
+class ClockCache {
+public:
+    explicit ClockCache(size_t capacity)
+        : capacity_(capacity) {
+        slots_.reserve(capacity);
+        index_.reserve(capacity);
+    }
+
+    std::optional<Value> Find(const Key& key, uint64_t version) {
+        std::lock_guard guard(mutex_);
+        SyncVersion(version);
+        const auto it = index_.find(key);
+        if (it == index_.end()) {
+            ++misses_;
+            return std::nullopt;
+        }
+        ++hits_;
+        Slot& slot = slots_[it->second];
+        slot.referenced = true;
+        return slot.value;
+    }
+
+    void Insert(const Key& key, uint64_t version, Value value) {
+        std::lock_guard guard(mutex_);
+        SyncVersion(version);
+        if (capacity_ == 0) {
+            return;
+        }
+        if (const auto it = index_.find(key); it != index_.end()) {
+            slots_[it->second].value = std::move(value);
+            return;
+        }
+        if (slots_.size() < capacity_) {
+            index_.emplace(key, slots_.size());
+            slots_.push_back({key, std::move(value), false});
+            return;
+        }
+
+        while (slots_[hand_].referenced) {
+            slots_[hand_].referenced = false;
+            hand_ = (hand_ + 1) % slots_.size();
+        }
+        Slot& victim = slots_[hand_];
+        index_.erase(victim.key);
+        ++evictions_;
+        victim = {key, std::move(value), false};
+        index_.emplace(key, hand_);
+        hand_ = (hand_ + 1) % slots_.size();
+    }
+
+    void Clear() {
+        std::lock_guard guard(mutex_);
+        ClearLocked();
+    }
+
+    ClockCacheStats GetStats() const {
+        std::lock_guard guard(mutex_);
+        return {hits_, misses_, evictions_, slots_.size(), capacity_};
+    }
+
+private:
+    struct Slot {
+        Key key;
+        Value value;
+        bool referenced = false;
+    };
+
+    void SyncVersion(uint64_t version) {
+        if (version != version_) {
+            ClearLocked();
+            version_ = version;
+        }
+    }
+
+    void ClearLocked() {
+        slots_.clear();
+        index_.clear();
+        hand_ = 0;
+    }
+
+    mutable std::mutex mutex_;
+    size_t capacity_;
+    std::vector<Slot> slots_;
+    std::unordered_map<Key, size_t, Hasher> index_;
+    size_t hand_ = 0;
+    uint64_t version_ = 0;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+    size_t evictions_ = 0;
+};
+
+}  // namespace cache
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "blocked_floyd_warshall.h"
+#include "dijkstra_all_pairs.h"
+#include "dynamic_all_pairs.h"
+#include "flat_route_table.h"
+#include "graph.h"
+#include "router.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Предрасчёт всех пар с компактной таблицей FlatRouteTable блочным
+// Флойдом–Уоршеллом или поисками Дейкстры из каждой вершины на thread_count
+// потоках (0 — по числу ядер).
+// Веса в таблице хранятся с пониженной точностью и нужны только для выбора
+// пути; вес найденного маршрута пересчитывается по рёбрам графа.
+template <typename Weight, typename StoredWeight = float>
+class CompactRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Table = FlatRouteTable<StoredWeight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+
+    explicit CompactRouter(const Graph& graph, size_t thread_count = 0,
+                           AllPairsMethod method = AllPairsMethod::AUTO);
+    // Готовая таблица, например загруженная из файла, без предрасчёта
+    CompactRouter(const Graph& graph, Table table);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Обновляет таблицу после правки графа, как Router::Update. Таблица,
+    // загруженная из файла, сначала копируется в собственную память
+    void Update(const std::vector<EdgeId>& added_edges, const std::vector<EdgeId>& removed_edges,
+                size_t thread_count = 0);
+
+    const Table& GetTable() const {
+        return table_;
+    }
+
+private:
+    // Адаптер таблицы для detail::AllPairsUpdater
+    class TableAccess {
+    public:
+        explicit TableAccess(Table& table)
+            : table_(table) {
+        }
+
+        size_t GetVertexCount() const {
+            return table_.GetVertexCount();
+        }
+        bool IsReachable(VertexId from, VertexId to) const {
+            return table_.GetWeightRow(from)[to] != Table::UNREACHABLE;
+        }
+        StoredWeight GetWeight(VertexId from, VertexId to) const {
+            return table_.GetWeightRow(from)[to];
+        }
+        EdgeId GetPrevEdge(VertexId from, VertexId to) const {
+            const uint32_t edge_id = table_.GetPrevEdgeRow(from)[to];
+            return edge_id == NO_EDGE ? detail::NO_TABLE_EDGE : edge_id;
+        }
+        void Set(VertexId from, VertexId to, Weight weight, EdgeId prev_edge) {
+            table_.GetWeightRow(from)[to] = static_cast<StoredWeight>(weight);
+            table_.GetPrevEdgeRow(from)[to] =
+                prev_edge == detail::NO_TABLE_EDGE ? NO_EDGE : static_cast<uint32_t>(prev_edge);
+        }
+        void Clear(VertexId from, VertexId to) {
+            table_.GetWeightRow(from)[to] = Table::UNREACHABLE;
+            table_.GetPrevEdgeRow(from)[to] = NO_EDGE;
+        }
+
+    private:
+        Table& table_;
+    };
+
+    void InitializeTable();
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr uint32_t NO_EDGE = Table::NO_EDGE;
+
+    const Graph& graph_;
+    Table table_;
+};
+
+template <typename Weight, typename StoredWeight>
+CompactRouter<Weight, StoredWeight>::CompactRouter(const Graph& graph, size_t thread_count,
+                                                   AllPairsMethod method)
+    : graph_(graph)
+    , table_(graph.GetVertexCount())
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building a router");
+    }
+    if (graph.GetEdgeCount() >= NO_EDGE) {
+        throw std::length_error("Too many edges for a compact route table");
+    }
+
+    parallel::ThreadPool pool(thread_count);
+    method = ChooseAllPairsMethod(method, graph.GetVertexCount(), graph.GetEdgeCount());
+    if (method == AllPairsMethod::DIJKSTRA) {
+        TableAccess table(table_);
+        detail::DijkstraAllPairs<Weight, TableAccess>(graph, table, pool).Run();
+    } else {
+        InitializeTable();
+        detail::BlockedFloydWarshall<StoredWeight>(table_, pool).Run();
+    }
+}
+
+template <typename Weight, typename StoredWeight>
+CompactRouter<Weight, StoredWeight>::CompactRouter(const Graph& graph, Table table)
+    : graph_(graph)
+    , table_(std::move(table))
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building a router");
+    }
+    if (table_.GetVertexCount() != graph.GetVertexCount()) {
+        throw std::invalid_argument("Route table does not match the graph");
+    }
+}
+
+template <typename Weight, typename StoredWeight>
+void CompactRouter<Weight, StoredWeight>::InitializeTable() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        StoredWeight* weights = table_.GetWeightRow(vertex);
+        uint32_t* prev_edges = table_.GetPrevEdgeRow(vertex);
+        weights[vertex] = StoredWeight{};
+        for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+            if (arc.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            const auto weight = static_cast<StoredWeight>(arc.weight);
+            if (arc.vertex != vertex && weight < weights[arc.vertex]) {
+                weights[arc.vertex] = weight;
+                prev_edges[arc.vertex] = static_cast<uint32_t>(arc.edge_id);
+            }
+        }
+    }
+}
+
+template <typename Weight, typename StoredWeight>
+void CompactRouter<Weight, StoredWeight>::Update(const std::vector<EdgeId>& added_edges,
+                                                 const std::vector<EdgeId>& removed_edges,
+                                                 size_t thread_count) {
+    if (!graph_.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before updating a router");
+    }
+    if (graph_.GetEdgeCount() >= NO_EDGE) {
+        throw std::length_error("Too many edges for a compact route table");
+    }
+    for (const EdgeId edge_id : added_edges) {
+        if (graph_.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    const size_t old_vertex_count = table_.GetVertexCount();
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (table_.IsView() || vertex_count != old_vertex_count) {
+        table_.Resize(vertex_count);
+    }
+    for (VertexId vertex = old_vertex_count; vertex < vertex_count; ++vertex) {
+        table_.GetWeightRow(vertex)[vertex] = StoredWeight{};
+    }
+
+    parallel::ThreadPool pool(thread_count);
+    TableAccess table(table_);
+    detail::AllPairsUpdater<Weight, TableAccess>(graph_, table, pool)
+        .Update(added_edges, removed_edges);
+}
+
+template <typename Weight, typename StoredWeight>
+std::optional<typename CompactRouter<Weight, StoredWeight>::RouteInfo>
+CompactRouter<Weight, StoredWeight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= table_.GetVertexCount() || to >= table_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    if (table_.GetWeightRow(from)[to] == Table::UNREACHABLE) {
+        return std::nullopt;
+    }
+
+    const uint32_t* prev_edges = table_.GetPrevEdgeRow(from);
+    std::vector<EdgeId> edges;
+    for (uint32_t edge_id = prev_edges[to]; edge_id != NO_EDGE;
+         edge_id = prev_edges[graph_.GetEdge(edge_id).from]) {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    Weight weight = ZERO_WEIGHT;
+    for (const EdgeId edge_id : edges) {
+        weight += graph_.GetEdge(edge_id).weight;
+    }
+
+    return RouteInfo{weight, std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Слабо связные компоненты графа: вершины, связанные рёбрами без учёта их
+// направления. Между вершинами разных компонент пути нет ни в одну сторону.
+// Компоненты нумеруются по возрастанию наименьшей вершины, внутри компоненты
+// у вершины свой номер — в порядке возрастания номеров в графе.
+class GraphComponents {
+public:
+    GraphComponents() = default;
+
+    template <typename Weight>
+    explicit GraphComponents(const DirectedWeightedGraph<Weight>& graph);
+
+    size_t GetVertexCount() const {
+        return components_.size();
+    }
+
+    size_t GetComponentCount() const {
+        return component_vertices_.size();
+    }
+
+    uint32_t GetComponent(VertexId vertex) const {
+        return components_[vertex];
+    }
+
+    VertexId GetLocalVertex(VertexId vertex) const {
+        return local_vertices_[vertex];
+    }
+
+    // Вершины компоненты в графе по возрастанию
+    const std::vector<VertexId>& GetVertices(size_t component) const {
+        return component_vertices_[component];
+    }
+
+    bool IsConnected(VertexId from, VertexId to) const {
+        return components_[from] == components_[to];
+    }
+
+private:
+    std::vector<uint32_t> components_;
+    std::vector<VertexId> local_vertices_;
+    std::vector<std::vector<VertexId>> component_vertices_;
+};
+
+template <typename Weight>
+GraphComponents::GraphComponents(const DirectedWeightedGraph<Weight>& graph) {
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before finding components");
+    }
+    constexpr uint32_t NO_COMPONENT = UINT32_MAX;
+    const size_t vertex_count = graph.GetVertexCount();
+    components_.assign(vertex_count, NO_COMPONENT);
+    local_vertices_.resize(vertex_count);
+
+    std::vector<VertexId> stack;
+    for (VertexId root = 0; root < vertex_count; ++root) {
+        if (components_[root] != NO_COMPONENT) {
+            continue;
+        }
+        const auto component = static_cast<uint32_t>(component_vertices_.size());
+        components_[root] = component;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const VertexId vertex = stack.back();
+            stack.pop_back();
+            for (const auto arcs : {graph.GetOutgoingArcs(vertex), graph.GetIncomingArcs(vertex)}) {
+                for (const auto& arc : arcs) {
+                    if (components_[arc.vertex] == NO_COMPONENT) {
+                        components_[arc.vertex] = component;
+                        stack.push_back(arc.vertex);
+                    }
+                }
+            }
+        }
+        component_vertices_.emplace_back();
+    }
+
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        auto& vertices = component_vertices_[components_[vertex]];
+        local_vertices_[vertex] = static_cast<VertexId>(vertices.size());
+        vertices.push_back(vertex);
+    }
+}
+
+// Маршрутизатор, который строит отдельный маршрутизатор Inner на подграфе
+// каждой слабо связной компоненты. Таблицам всех пар это даёт память
+// и предрасчёт по сумме квадратов размеров компонент вместо V^2, а запрос
+// между компонентами отвечается без поиска. Рёбра подграфа нумеруются
+// заново; маршрут возвращается в EdgeId исходного графа.
+// Запросы можно вызывать из нескольких потоков, если это допускает Inner;
+// Update вызывается, когда запросов нет.
+template <typename Weight, typename Inner = RouterBase<Weight>>
+class ComponentRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+    // Маршрутизатор компоненты component по её замороженному подграфу;
+    // подграф живёт, пока жив маршрутизатор
+    using Factory = std::function<std::unique_ptr<Inner>(size_t component, const Graph& subgraph)>;
+
+    ComponentRouter(const Graph& graph, GraphComponents components, const Factory& make_router);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    size_t GetSettledCount() const override {
+        const Inner* last_router = last_router_;
+        return last_router ? last_router->GetSettledCount() : 0;
+    }
+
+    // Обновляет маршрутизатор после правки графа (граф уже снова заморожен),
+    // components — компоненты нового графа. Компоненты, вершины которых не
+    // изменились и не задеты рёбрами added_edges и removed_edges, сохраняют
+    // свои маршрутизаторы, остальные строятся заново через make_router
+    void Update(const std::vector<EdgeId>& added_edges, const std::vector<EdgeId>& removed_edges,
+                GraphComponents components, const Factory& make_router);
+
+    const GraphComponents& GetComponents() const {
+        return components_;
+    }
+
+    const Inner& GetRouter(size_t component) const {
+        return *parts_[component].router;
+    }
+
+    const Graph& GetSubgraph(size_t component) const {
+        return *parts_[component].subgraph;
+    }
+
+private:
+    struct Part {
+        std::unique_ptr<Graph> subgraph;
+        std::vector<EdgeId> edges;  // EdgeId исходного графа по EdgeId подграфа
+        std::unique_ptr<Inner> router;
+    };
+
+    Part MakePart(size_t component, const Factory& make_router) const;
+
+    const Graph& graph_;
+    GraphComponents components_;
+    std::vector<Part> parts_;
+    mutable std::atomic<const Inner*> last_router_ = nullptr;
+};
+
+template <typename Weight, typename Inner>
+ComponentRouter<Weight, Inner>::ComponentRouter(const Graph& graph, GraphComponents components,
+                                                const Factory& make_router)
+    : graph_(graph)
+    , components_(std::move(components))
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building a router");
+    }
+    parts_.reserve(components_.GetComponentCount());
+    for (size_t component = 0; component < components_.GetComponentCount(); ++component) {
+        parts_.push_back(MakePart(component, make_router));
+    }
+}
+
+template <typename Weight, typename Inner>
+typename ComponentRouter<Weight, Inner>::Part ComponentRouter<Weight, Inner>::MakePart(
+    size_t component, const Factory& make_router) const {
+    const auto& vertices = components_.GetVertices(component);
+    Part part;
+    part.subgraph = std::make_unique<Graph>(vertices.size());
+    // Удалённые рёбра есть только в edges_ графа, поэтому рёбра берутся
+    // из списков смежности
+    for (const VertexId vertex : vertices) {
+        for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+            part.subgraph->AddEdge({components_.GetLocalVertex(vertex),
+                                    components_.GetLocalVertex(arc.vertex), arc.weight});
+            part.edges.push_back(arc.edge_id);
+        }
+    }
+    part.subgraph->Freeze();
+    part.router = make_router(component, *part.subgraph);
+    return part;
+}
+
+template <typename Weight, typename Inner>
+std::optional<typename ComponentRouter<Weight, Inner>::RouteInfo>
+ComponentRouter<Weight, Inner>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (!components_.IsConnected(from, to)) {
+        last_router_ = nullptr;
+        return std::nullopt;
+    }
+
+    const Part& part = parts_[components_.GetComponent(from)];
+    last_router_ = part.router.get();
+    auto route = part.router->BuildRoute(components_.GetLocalVertex(from),
+                                         components_.GetLocalVertex(to));
+    if (route) {
+        for (EdgeId& edge_id : route->edges) {
+            edge_id = part.edges[edge_id];
+        }
+    }
+    return route;
+}
+
+template <typename Weight, typename Inner>
+void ComponentRouter<Weight, Inner>::Update(const std::vector<EdgeId>& added_edges,
+                                            const std::vector<EdgeId>& removed_edges,
+                                            GraphComponents components,
+                                            const Factory& make_router) {
+    if (!graph_.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before updating a router");
+    }
+    // Прежние компоненты, задетые правкой
+    std::vector<char> is_touched(components_.GetComponentCount(), false);
+    const size_t old_vertex_count = components_.GetVertexCount();
+    for (const auto* edges : {&added_edges, &removed_edges}) {
+        for (const EdgeId edge_id : *edges) {
+            const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+            for (const VertexId vertex : {edge.from, edge.to}) {
+                if (vertex < old_vertex_count) {
+                    is_touched[components_.GetComponent(vertex)] = true;
+                }
+            }
+        }
+    }
+
+    // Компонента сохраняется, если она совпадает с прежней нетронутой
+    // компонентой своей наименьшей вершины
+    std::vector<Part> parts;
+    parts.reserve(components.GetComponentCount());
+    for (size_t component = 0; component < components.GetComponentCount(); ++component) {
+        const auto& vertices = components.GetVertices(component);
+        const VertexId first = vertices.front();
+        if (first < old_vertex_count) {
+            const uint32_t old_component = components_.GetComponent(first);
+            if (!is_touched[old_component] && components_.GetVertices(old_component) == vertices) {
+                parts.push_back(std::move(parts_[old_component]));
+                continue;
+            }
+        }
+        parts.push_back(Part{});
+    }
+
+    components_ = std::move(components);
+    last_router_ = nullptr;
+    for (size_t component = 0; component < parts.size(); ++component) {
+        if (!parts[component].router) {
+            parts[component] = MakePart(component, make_router);
+        }
+    }
+    parts_ = std::move(parts);
+    last_router_ = nullptr;
+}
+
+}  // namespace graph
@@ -0,0 +1,511 @@
+#pragma once
+
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+#include "state_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Ребро иерархии: либо исходное ребро графа, либо shortcut, заменяющий
+// путь из двух рёбер иерархии через стянутую вершину
+template <typename Weight>
+struct HierarchyEdge {
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    VertexId from;
+    VertexId to;
+    Weight weight;
+    EdgeId original = NO_EDGE;     // id исходного ребра; NO_EDGE для shortcut
+    size_t first_half = NO_EDGE;   // рёбра иерархии, из которых состоит shortcut
+    size_t second_half = NO_EDGE;
+
+    bool IsShortcut() const {
+        return original == NO_EDGE;
+    }
+};
+
+namespace detail {
+
+// Предрасчёт иерархии стягиванием вершин. Порядок стягивания выбирается
+// по приоритету "разность рёбер" (сколько shortcut добавится минус сколько
+// рёбер исчезнет) плюс число уже стянутых соседей; приоритеты обновляются
+// лениво при извлечении вершины из очереди.
+template <typename Weight>
+class HierarchyBuilder {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Edge = HierarchyEdge<Weight>;
+
+public:
+    explicit HierarchyBuilder(const Graph& graph);
+
+    // Стягивает все вершины; возвращает ранги вершин (порядок стягивания)
+    std::vector<size_t> Build();
+
+    std::vector<Edge>& GetEdges() {
+        return edges_;
+    }
+
+private:
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        size_t first_half;
+        size_t second_half;
+    };
+
+    // Перебирает пары вход-выход через vertex, для которых нет пути-свидетеля
+    // не длиннее пути через vertex; settle_limit ограничивает локальный поиск
+    void FindShortcuts(VertexId vertex, size_t settle_limit, std::vector<Shortcut>& shortcuts);
+    // Локальный поиск из source в обход ignored; завершается, когда извлечены
+    // все отмеченные цели, превышен вес limit или число вершин settle_limit
+    void RunWitnessSearch(VertexId source, VertexId ignored, size_t target_count,
+                          Weight limit, size_t settle_limit);
+    int ComputePriority(VertexId vertex);
+    void Contract(VertexId vertex);
+    void AddShortcut(const Shortcut& shortcut);
+
+    static constexpr size_t SIMULATION_SETTLE_LIMIT = 20;
+    static constexpr size_t CONTRACTION_SETTLE_LIMIT = 100;
+
+    size_t vertex_count_;
+    std::vector<Edge> edges_;
+    std::vector<std::vector<size_t>> outgoing_;
+    std::vector<std::vector<size_t>> incoming_;
+    std::vector<bool> contracted_;
+    std::vector<int> contracted_neighbours_;
+    SearchState<Weight> witness_;
+    std::vector<size_t> target_marks_;
+    size_t target_generation_ = 0;
+    std::vector<Shortcut> shortcuts_buffer_;
+};
+
+template <typename Weight>
+HierarchyBuilder<Weight>::HierarchyBuilder(const Graph& graph)
+    : vertex_count_(graph.GetVertexCount())
+    , outgoing_(vertex_count_)
+    , incoming_(vertex_count_)
+    , contracted_(vertex_count_, false)
+    , contracted_neighbours_(vertex_count_, 0)
+    , witness_(vertex_count_)
+    , target_marks_(vertex_count_, 0)
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building a router");
+    }
+    for (VertexId from = 0; from < vertex_count_; ++from) {
+        for (const auto& arc : graph.GetOutgoingArcs(from)) {
+            if (arc.weight < Weight{}) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            // Петли никогда не входят в кратчайший путь
+            if (arc.vertex == from) {
+                continue;
+            }
+            outgoing_[from].push_back(edges_.size());
+            incoming_[arc.vertex].push_back(edges_.size());
+            edges_.push_back({from, arc.vertex, arc.weight, arc.edge_id});
+        }
+    }
+}
+
+template <typename Weight>
+void HierarchyBuilder<Weight>::RunWitnessSearch(VertexId source, VertexId ignored,
+                                                size_t target_count, Weight limit,
+                                                size_t settle_limit) {
+    witness_.Start();
+    witness_.Relax(source, Weight{}, Edge::NO_EDGE);
+    while (target_count > 0 && !witness_.IsQueueEmpty() && witness_.GetMinKey() <= limit
+           && witness_.GetSettledCount() < settle_limit) {
+        const VertexId vertex = witness_.PopMin();
+        if (target_marks_[vertex] == target_generation_) {
+            --target_count;
+        }
+        const Weight weight = witness_.GetWeight(vertex);
+        for (const size_t edge_index : outgoing_[vertex]) {
+            const Edge& edge = edges_[edge_index];
+            if (edge.to != ignored && !contracted_[edge.to]) {
+                witness_.Relax(edge.to, weight + edge.weight, edge_index);
+            }
+        }
+    }
+}
+
+template <typename Weight>
+void HierarchyBuilder<Weight>::FindShortcuts(VertexId vertex, size_t settle_limit,
+                                             std::vector<Shortcut>& shortcuts) {
+    shortcuts.clear();
+
+    if (outgoing_[vertex].empty()) {
+        return;
+    }
+
+    // Цели поиска-свидетеля — концы исходящих рёбер
+    ++target_generation_;
+    size_t target_count = 0;
+    Weight max_outgoing{};
+    for (const size_t out_index : outgoing_[vertex]) {
+        const Edge& out_edge = edges_[out_index];
+        max_outgoing = std::max(max_outgoing, out_edge.weight);
+        if (target_marks_[out_edge.to] != target_generation_) {
+            target_marks_[out_edge.to] = target_generation_;
+            ++target_count;
+        }
+    }
+
+    for (const size_t in_index : incoming_[vertex]) {
+        const Edge& in_edge = edges_[in_index];
+        RunWitnessSearch(in_edge.from, vertex, target_count, in_edge.weight + max_outgoing,
+                         settle_limit);
+
+        for (const size_t out_index : outgoing_[vertex]) {
+            const Edge& out_edge = edges_[out_index];
+            if (out_edge.to == in_edge.from) {
+                continue;
+            }
+            const Weight via_weight = in_edge.weight + out_edge.weight;
+            if (witness_.IsReached(out_edge.to) && witness_.GetWeight(out_edge.to) <= via_weight) {
+                continue;
+            }
+            shortcuts.push_back({in_edge.from, out_edge.to, via_weight, in_index, out_index});
+        }
+    }
+}
+
+template <typename Weight>
+int HierarchyBuilder<Weight>::ComputePriority(VertexId vertex) {
+    FindShortcuts(vertex, SIMULATION_SETTLE_LIMIT, shortcuts_buffer_);
+
+    const int removed_edges = static_cast<int>(outgoing_[vertex].size() + incoming_[vertex].size());
+    return static_cast<int>(shortcuts_buffer_.size()) - removed_edges
+           + contracted_neighbours_[vertex];
+}
+
+template <typename Weight>
+void HierarchyBuilder<Weight>::AddShortcut(const Shortcut& shortcut) {
+    // Ребро между нестянутыми вершинами ещё не входит ни в один shortcut,
+    // поэтому более длинное параллельное ребро можно заменить на месте
+    for (const size_t edge_index : outgoing_[shortcut.from]) {
+        Edge& edge = edges_[edge_index];
+        if (edge.to == shortcut.to) {
+            if (shortcut.weight < edge.weight) {
+                edge = {shortcut.from, shortcut.to, shortcut.weight, Edge::NO_EDGE,
+                        shortcut.first_half, shortcut.second_half};
+            }
+            return;
+        }
+    }
+
+    outgoing_[shortcut.from].push_back(edges_.size());
+    incoming_[shortcut.to].push_back(edges_.size());
+    edges_.push_back({shortcut.from, shortcut.to, shortcut.weight, Edge::NO_EDGE,
+                      shortcut.first_half, shortcut.second_half});
+}
+
+template <typename Weight>
+void HierarchyBuilder<Weight>::Contract(VertexId vertex) {
+    FindShortcuts(vertex, CONTRACTION_SETTLE_LIMIT, shortcuts_buffer_);
+    contracted_[vertex] = true;
+    for (const Shortcut& shortcut : shortcuts_buffer_) {
+        AddShortcut(shortcut);
+    }
+
+    // Рёбра стянутой вершины убираются из списков соседей, чтобы дальнейшие
+    // поиски-свидетели и подсчёт приоритетов не перебирали их повторно
+    const auto remove_edge = [](std::vector<size_t>& list, size_t edge_index) {
+        list.erase(std::find(list.begin(), list.end(), edge_index));
+    };
+    for (const size_t edge_index : outgoing_[vertex]) {
+        const VertexId neighbour = edges_[edge_index].to;
+        remove_edge(incoming_[neighbour], edge_index);
+        ++contracted_neighbours_[neighbour];
+    }
+    for (const size_t edge_index : incoming_[vertex]) {
+        const VertexId neighbour = edges_[edge_index].from;
+        remove_edge(outgoing_[neighbour], edge_index);
+        ++contracted_neighbours_[neighbour];
+    }
+}
+
+template <typename Weight>
+std::vector<size_t> HierarchyBuilder<Weight>::Build() {
+    using QueueItem = std::pair<int, VertexId>;
+    std::vector<QueueItem> queue;
+    queue.reserve(vertex_count_);
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        queue.push_back({ComputePriority(vertex), vertex});
+    }
+    std::make_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+
+    std::vector<size_t> ranks(vertex_count_, 0);
+    size_t next_rank = 0;
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+        const VertexId vertex = queue.back().second;
+        queue.pop_back();
+
+        // Ленивое обновление: если приоритет вырос и вершина больше не лучшая, откладываем её
+        const int priority = ComputePriority(vertex);
+        if (!queue.empty() && priority > queue.front().first) {
+            queue.push_back({priority, vertex});
+            std::push_heap(queue.begin(), queue.end(), std::greater<QueueItem>{});
+            continue;
+        }
+
+        Contract(vertex);
+        ranks[vertex] = next_rank++;
+    }
+
+    return ranks;
+}
+
+}  // namespace detail
+
+// Маршрутизатор на основе иерархии стягивания (Contraction Hierarchies).
+// После предрасчёта запрос — двунаправленный поиск только по рёбрам,
+// ведущим к вершинам большего ранга; найденные shortcut раскрываются
+// обратно в исходные рёбра графа. Запросы можно вызывать из нескольких
+// потоков: каждый берёт свои рабочие массивы из пула.
+template <typename Weight>
+class ContractionHierarchyRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Edge = HierarchyEdge<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+
+    explicit ContractionHierarchyRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Число вершин, извлечённых последним завершённым запросом в обоих направлениях
+    size_t GetSettledCount() const override {
+        return settled_count_;
+    }
+
+    size_t GetShortcutCount() const;
+
+private:
+    // Рёбра иерархии, сгруппированные по вершинам (offsets размера V + 1)
+    struct Adjacency {
+        std::vector<size_t> offsets;
+        std::vector<size_t> edges;
+    };
+
+    // Состояние одного запроса
+    struct Search {
+        explicit Search(size_t vertex_count)
+            : forward(vertex_count)
+            , backward(vertex_count) {
+        }
+
+        detail::SearchState<Weight> forward;
+        detail::SearchState<Weight> backward;
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = 0;
+        std::vector<size_t> unpack_stack;
+    };
+
+    void BuildAdjacency(const std::vector<size_t>& ranks);
+    // forward: прямой поиск идёт по upward_, обратный — по downward_ в обратную сторону
+    void ExpandUpward(Search& search, bool forward) const;
+    bool IsStalled(const detail::SearchState<Weight>& state, VertexId vertex, bool forward) const;
+    void UnpackEdge(size_t edge_index, std::vector<size_t>& stack,
+                    std::vector<EdgeId>& edges) const;
+
+    static constexpr EdgeId NO_EDGE = Edge::NO_EDGE;
+
+    size_t vertex_count_;
+    std::vector<Edge> edges_;
+    Adjacency upward_;    // рёбра u -> w с rank(w) > rank(u), по вершине u
+    Adjacency downward_;  // рёбра u -> w с rank(u) > rank(w), по вершине w
+    parallel::StatePool<Search> searches_;
+    mutable std::atomic<size_t> settled_count_ = 0;
+};
+
+template <typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph)
+    : vertex_count_(graph.GetVertexCount())
+{
+    detail::HierarchyBuilder<Weight> builder(graph);
+    const std::vector<size_t> ranks = builder.Build();
+    edges_ = std::move(builder.GetEdges());
+    BuildAdjacency(ranks);
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::BuildAdjacency(const std::vector<size_t>& ranks) {
+    upward_.offsets.assign(vertex_count_ + 1, 0);
+    downward_.offsets.assign(vertex_count_ + 1, 0);
+    for (const Edge& edge : edges_) {
+        if (ranks[edge.to] > ranks[edge.from]) {
+            ++upward_.offsets[edge.from + 1];
+        } else {
+            ++downward_.offsets[edge.to + 1];
+        }
+    }
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        upward_.offsets[vertex + 1] += upward_.offsets[vertex];
+        downward_.offsets[vertex + 1] += downward_.offsets[vertex];
+    }
+
+    upward_.edges.resize(upward_.offsets.back());
+    downward_.edges.resize(downward_.offsets.back());
+    std::vector<size_t> upward_fill(upward_.offsets.begin(), upward_.offsets.end() - 1);
+    std::vector<size_t> downward_fill(downward_.offsets.begin(), downward_.offsets.end() - 1);
+    for (size_t edge_index = 0; edge_index < edges_.size(); ++edge_index) {
+        const Edge& edge = edges_[edge_index];
+        if (ranks[edge.to] > ranks[edge.from]) {
+            upward_.edges[upward_fill[edge.from]++] = edge_index;
+        } else {
+            downward_.edges[downward_fill[edge.to]++] = edge_index;
+        }
+    }
+}
+
+template <typename Weight>
+bool ContractionHierarchyRouter<Weight>::IsStalled(const detail::SearchState<Weight>& state,
+                                                   VertexId vertex, bool forward) const {
+    // Stall-on-demand: если в вершину ведёт более короткий путь через вершину
+    // большего ранга, её вес неточен и расширять её не нужно
+    const Adjacency& adjacency = forward ? downward_ : upward_;
+    const Weight weight = state.GetWeight(vertex);
+    for (size_t i = adjacency.offsets[vertex]; i < adjacency.offsets[vertex + 1]; ++i) {
+        const Edge& edge = edges_[adjacency.edges[i]];
+        const VertexId higher = forward ? edge.from : edge.to;
+        if (state.IsReached(higher) && state.GetWeight(higher) + edge.weight < weight) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::ExpandUpward(Search& search, bool forward) const {
+    detail::SearchState<Weight>& state = forward ? search.forward : search.backward;
+    const detail::SearchState<Weight>& other = forward ? search.backward : search.forward;
+    const VertexId vertex = state.PopMin();
+    if (IsStalled(state, vertex, forward)) {
+        return;
+    }
+
+    const Adjacency& adjacency = forward ? upward_ : downward_;
+    const Weight weight = state.GetWeight(vertex);
+    for (size_t i = adjacency.offsets[vertex]; i < adjacency.offsets[vertex + 1]; ++i) {
+        const size_t edge_index = adjacency.edges[i];
+        const Edge& edge = edges_[edge_index];
+        const VertexId next = forward ? edge.to : edge.from;
+        if (state.Relax(next, weight + edge.weight, edge_index) && other.IsReached(next)) {
+            const Weight candidate = state.GetWeight(next) + other.GetWeight(next);
+            if (!search.best_weight || candidate < *search.best_weight) {
+                search.best_weight = candidate;
+                search.meeting_vertex = next;
+            }
+        }
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::UnpackEdge(size_t edge_index, std::vector<size_t>& stack,
+                                                    std::vector<EdgeId>& edges) const {
+    stack.clear();
+    stack.push_back(edge_index);
+    while (!stack.empty()) {
+        const Edge& edge = edges_[stack.back()];
+        stack.pop_back();
+        if (edge.IsShortcut()) {
+            stack.push_back(edge.second_half);
+            stack.push_back(edge.first_half);
+        } else {
+            edges.push_back(edge.original);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo>
+ContractionHierarchyRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    const auto lease = searches_.Acquire([this] {
+        return Search(vertex_count_);
+    });
+    Search& search = *lease;
+    search.forward.Start();
+    search.backward.Start();
+    search.best_weight.reset();
+    search.forward.Relax(from, Weight{}, NO_EDGE);
+    search.backward.Relax(to, Weight{}, NO_EDGE);
+    if (from == to) {
+        search.best_weight = Weight{};
+        search.meeting_vertex = from;
+    }
+
+    // Направление продолжает поиск, пока его минимум меньше лучшего найденного пути:
+    // кратчайший путь в иерархии поднимается до вершины наибольшего ранга и спускается
+    for (;;) {
+        const auto is_active = [&search](detail::SearchState<Weight>& state) {
+            return !state.IsQueueEmpty()
+                   && (!search.best_weight || state.GetMinKey() < *search.best_weight);
+        };
+        const bool forward_active = is_active(search.forward);
+        const bool backward_active = is_active(search.backward);
+        if (!forward_active && !backward_active) {
+            break;
+        }
+        if (forward_active) {
+            ExpandUpward(search, true);
+        }
+        if (backward_active) {
+            ExpandUpward(search, false);
+        }
+    }
+    settled_count_ = search.forward.GetSettledCount() + search.backward.GetSettledCount();
+
+    if (!search.best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<size_t> hierarchy_path;
+    for (size_t edge_index = search.forward.GetPrevEdge(search.meeting_vertex);
+         edge_index != NO_EDGE;
+         edge_index = search.forward.GetPrevEdge(edges_[edge_index].from)) {
+        hierarchy_path.push_back(edge_index);
+    }
+    std::reverse(hierarchy_path.begin(), hierarchy_path.end());
+    for (size_t edge_index = search.backward.GetPrevEdge(search.meeting_vertex);
+         edge_index != NO_EDGE;
+         edge_index = search.backward.GetPrevEdge(edges_[edge_index].to)) {
+        hierarchy_path.push_back(edge_index);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const size_t edge_index : hierarchy_path) {
+        UnpackEdge(edge_index, search.unpack_stack, edges);
+    }
+
+    return RouteInfo{*search.best_weight, std::move(edges)};
+}
+
+template <typename Weight>
+size_t ContractionHierarchyRouter<Weight>::GetShortcutCount() const {
+    return std::count_if(edges_.begin(), edges_.end(),
+                         [](const Edge& edge) { return edge.IsShortcut(); });
+}
+
+}  // namespace graph
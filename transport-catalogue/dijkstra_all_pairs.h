@@ -0,0 +1,155 @@
+#pragma once
+
+#include "dynamic_all_pairs.h"
+#include "graph.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Способ предрасчёта таблицы всех пар
+enum class AllPairsMethod {
+    AUTO,            // по плотности графа, см. ChooseAllPairsMethod
+    FLOYD_WARSHALL,  // O(V^3) независимо от числа рёбер
+    DIJKSTRA         // V поисков Дейкстры, O(V * E log V): выгоднее на разреженных графах
+};
+
+// Для AUTO: Дейкстра, если E * log2(V) заметно меньше V^2. Проход
+// Флойда–Уоршелла векторизован и на операцию в несколько раз дешевле
+// шага поиска с кучей, отсюда запас DIJKSTRA_COST_FACTOR
+inline AllPairsMethod ChooseAllPairsMethod(AllPairsMethod method, size_t vertex_count,
+                                           size_t edge_count) {
+    constexpr double DIJKSTRA_COST_FACTOR = 8.0;
+    if (method != AllPairsMethod::AUTO) {
+        return method;
+    }
+    const double log_vertex_count = std::log2(static_cast<double>(std::max<size_t>(vertex_count, 2)));
+    const double dijkstra_cost = DIJKSTRA_COST_FACTOR * static_cast<double>(edge_count) * log_vertex_count;
+    const double floyd_warshall_cost = static_cast<double>(vertex_count) * static_cast<double>(vertex_count);
+    return dijkstra_cost < floyd_warshall_cost ? AllPairsMethod::DIJKSTRA
+                                               : AllPairsMethod::FLOYD_WARSHALL;
+}
+
+namespace detail {
+
+// Таблица всех пар поисками Дейкстры из каждой вершины. Table — тот же
+// адаптер, что у AllPairsUpdater; используется только Set, в строку
+// источника после его поиска. Таблица должна быть пустой (все пары
+// недостижимы). Источники раздаются пулу по одному, так что свободный поток
+// сразу забирает следующий и длинные поиски не задерживают остальных.
+// У каждого потока свои куча и рабочие массивы, переиспользуемые между
+// поисками; веса считаются в Weight независимо от типа таблицы.
+template <typename Weight, typename Table>
+class DijkstraAllPairs {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    DijkstraAllPairs(const Graph& graph, Table& table, parallel::ThreadPool& pool)
+        : graph_(graph)
+        , table_(table)
+        , pool_(pool)
+        , vertex_count_(graph.GetVertexCount()) {
+        for (VertexId from = 0; from < vertex_count_; ++from) {
+            for (const auto& arc : graph_.GetOutgoingArcs(from)) {
+                if (arc.weight < Weight{}) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+            }
+        }
+    }
+
+    void Run() {
+        std::vector<Workspace> workspaces;
+        workspaces.reserve(pool_.GetThreadCount());
+        for (size_t worker = 0; worker < pool_.GetThreadCount(); ++worker) {
+            workspaces.emplace_back(vertex_count_);
+        }
+        pool_.ParallelFor(vertex_count_, [this, &workspaces](size_t from, size_t worker) {
+            RunSearch(static_cast<VertexId>(from), workspaces[worker]);
+        });
+    }
+
+private:
+    struct QueueItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    // Массивы одного потока; актуальность ячейки — по номеру поколения
+    struct Workspace {
+        explicit Workspace(size_t vertex_count)
+            : weights(vertex_count)
+            , prev_edges(vertex_count, NO_TABLE_EDGE)
+            , stamps(vertex_count, 0) {
+        }
+
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::vector<uint32_t> stamps;
+        uint32_t generation = 0;
+        std::vector<QueueItem> queue;
+        std::vector<VertexId> settled;
+    };
+
+    void RunSearch(VertexId from, Workspace& workspace) {
+        if (++workspace.generation == 0) {
+            std::fill(workspace.stamps.begin(), workspace.stamps.end(), 0);
+            workspace.generation = 1;
+        }
+        workspace.queue.clear();
+        workspace.settled.clear();
+
+        Relax(from, Weight{}, NO_TABLE_EDGE, workspace);
+        while (!workspace.queue.empty()) {
+            std::pop_heap(workspace.queue.begin(), workspace.queue.end(), std::greater<QueueItem>{});
+            const auto [weight, vertex] = workspace.queue.back();
+            workspace.queue.pop_back();
+            if (workspace.weights[vertex] < weight) {
+                continue;
+            }
+            workspace.settled.push_back(vertex);
+            for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+                Relax(arc.vertex, weight + arc.weight, arc.edge_id, workspace);
+            }
+        }
+
+        // Строка пишется после поиска: вершины в порядке извлечения,
+        // поэтому у каждой вершины вес уже окончательный
+        for (const VertexId vertex : workspace.settled) {
+            table_.Set(from, vertex, workspace.weights[vertex], workspace.prev_edges[vertex]);
+        }
+    }
+
+    static void Relax(VertexId vertex, Weight weight, EdgeId prev_edge, Workspace& workspace) {
+        if (workspace.stamps[vertex] == workspace.generation
+            && !(weight < workspace.weights[vertex])) {
+            return;
+        }
+        workspace.stamps[vertex] = workspace.generation;
+        workspace.weights[vertex] = weight;
+        workspace.prev_edges[vertex] = prev_edge;
+        workspace.queue.push_back({weight, vertex});
+        std::push_heap(workspace.queue.begin(), workspace.queue.end(), std::greater<QueueItem>{});
+    }
+
+    const Graph& graph_;
+    Table& table_;
+    parallel::ThreadPool& pool_;
+    size_t vertex_count_;
+};
+
+}  // namespace detail
+
+}  // namespace graph
@@ -0,0 +1,390 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "state_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Дерево кратчайших путей из одной вершины: вес пути до каждой вершины
+// и последнее ребро этого пути. Недостижимые вершины (кроме корня)
+// имеют prev_edges[v] == NO_EDGE.
+template <typename Weight>
+struct ShortestPathTree {
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    VertexId root = 0;
+    std::vector<Weight> weights;
+    std::vector<EdgeId> prev_edges;
+
+    bool IsReached(VertexId vertex) const {
+        return vertex == root || prev_edges[vertex] != NO_EDGE;
+    }
+
+    size_t GetMemoryUsage() const {
+        return weights.capacity() * sizeof(Weight) + prev_edges.capacity() * sizeof(EdgeId);
+    }
+};
+
+namespace detail {
+
+// Рабочее состояние одного направления поиска Дейкстры: веса, последние рёбра
+// и очередь с приоритетом. Массивы переиспользуются между запросами: вместо
+// их очистки увеличивается номер поколения, и значение в ячейке считается
+// актуальным, только если её метка совпадает с текущим поколением.
+template <typename Weight>
+class SearchState {
+public:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    explicit SearchState(size_t vertex_count)
+        : weights_(vertex_count)
+        , prev_edges_(vertex_count, NO_EDGE)
+        , stamps_(vertex_count, 0) {
+    }
+
+    void Start() {
+        if (++generation_ == 0) {
+            std::fill(stamps_.begin(), stamps_.end(), 0);
+            generation_ = 1;
+        }
+        queue_.clear();
+        settled_count_ = 0;
+    }
+
+    bool IsReached(VertexId vertex) const {
+        return stamps_[vertex] == generation_;
+    }
+
+    Weight GetWeight(VertexId vertex) const {
+        return weights_[vertex];
+    }
+
+    EdgeId GetPrevEdge(VertexId vertex) const {
+        return prev_edges_[vertex];
+    }
+
+    // Обновляет вершину, если вес меньше известного; key — приоритет в очереди
+    bool Relax(VertexId vertex, Weight weight, EdgeId prev_edge, Weight key) {
+        if (IsReached(vertex) && !(weight < weights_[vertex])) {
+            return false;
+        }
+        stamps_[vertex] = generation_;
+        weights_[vertex] = weight;
+        prev_edges_[vertex] = prev_edge;
+        queue_.push_back({key, weight, vertex});
+        std::push_heap(queue_.begin(), queue_.end(), std::greater<QueueItem>{});
+        return true;
+    }
+
+    bool Relax(VertexId vertex, Weight weight, EdgeId prev_edge) {
+        return Relax(vertex, weight, prev_edge, weight);
+    }
+
+    // Пуста ли очередь после удаления устаревших записей
+    bool IsQueueEmpty() {
+        DropStale();
+        return queue_.empty();
+    }
+
+    // Наименьший приоритет в очереди; вызывать после проверки IsQueueEmpty
+    Weight GetMinKey() const {
+        return queue_.front().key;
+    }
+
+    // Извлекает ближайшую вершину; вызывать после проверки IsQueueEmpty
+    VertexId PopMin() {
+        std::pop_heap(queue_.begin(), queue_.end(), std::greater<QueueItem>{});
+        const VertexId vertex = queue_.back().vertex;
+        queue_.pop_back();
+        ++settled_count_;
+        return vertex;
+    }
+
+    size_t GetSettledCount() const {
+        return settled_count_;
+    }
+
+    size_t GetVertexCount() const {
+        return weights_.size();
+    }
+
+private:
+    struct QueueItem {
+        Weight key;
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return key > other.key;
+        }
+    };
+
+    // Устаревшая запись: вершина уже получила меньший вес
+    void DropStale() {
+        while (!queue_.empty() && weights_[queue_.front().vertex] < queue_.front().weight) {
+            std::pop_heap(queue_.begin(), queue_.end(), std::greater<QueueItem>{});
+            queue_.pop_back();
+        }
+    }
+
+    std::vector<Weight> weights_;
+    std::vector<EdgeId> prev_edges_;
+    std::vector<uint32_t> stamps_;
+    uint32_t generation_ = 0;
+    std::vector<QueueItem> queue_;
+    size_t settled_count_ = 0;
+};
+
+}  // namespace detail
+
+// Маршрутизатор без предрасчёта: на каждый запрос выполняется поиск Дейкстры
+// из одной вершины с остановкой при извлечении целевой вершины.
+// Запросы можно вызывать из нескольких потоков: каждый берёт свои рабочие
+// массивы из пула.
+template <typename Weight>
+class DijkstraRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+
+    explicit DijkstraRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Поиск с весами рёбер, заданными при запросе: edge_weight(edge_id) вместо
+    // весов графа. Веса должны быть неотрицательными, они не проверяются
+    template <typename EdgeWeight>
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to, EdgeWeight edge_weight) const;
+
+    // Полный поиск из вершины root; дерево перезаписывается, его память переиспользуется
+    void BuildTree(VertexId root, ShortestPathTree<Weight>& tree) const;
+
+    // Маршруты из from во все вершины targets одним поиском, который
+    // останавливается, когда извлечены все цели. Ответ — в порядке targets
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const;
+
+    // Вершины, достижимые из from с весом не больше max_weight, в порядке
+    // неубывания веса. Поиск останавливается на первой вершине дальше max_weight
+    std::vector<std::pair<VertexId, Weight>> FindReachable(VertexId from, Weight max_weight) const;
+
+    // Число вершин, извлечённых последним завершённым запросом
+    size_t GetSettledCount() const override {
+        return settled_count_;
+    }
+
+    const Graph& GetGraph() const {
+        return graph_;
+    }
+
+private:
+    using State = detail::SearchState<Weight>;
+    using StateLease = typename parallel::StatePool<State>::Lease;
+
+    StateLease AcquireState() const {
+        return states_.Acquire([this] {
+            return State(graph_.GetVertexCount());
+        });
+    }
+
+    // Поиск из from; останавливается, когда should_stop(vertex) вернёт true
+    // для извлечённой из очереди вершины, или когда очередь опустеет.
+    // arc_weight(arc) — вес дуги в поиске
+    template <typename StopCondition, typename ArcWeight>
+    void RunSearch(State& state, VertexId from, StopCondition should_stop,
+                   ArcWeight arc_weight) const;
+
+    template <typename StopCondition>
+    void RunSearch(State& state, VertexId from, StopCondition should_stop) const {
+        RunSearch(state, from, should_stop, [](const Arc<Weight>& arc) {
+            return arc.weight;
+        });
+    }
+
+    // Путь до достигнутой в поиске state вершины
+    RouteInfo ExtractRoute(const State& state, VertexId to) const;
+
+    void CheckVertex(VertexId vertex) const {
+        if (vertex >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr EdgeId NO_EDGE = ShortestPathTree<Weight>::NO_EDGE;
+
+    const Graph& graph_;
+    parallel::StatePool<State> states_;
+    mutable std::atomic<size_t> settled_count_ = 0;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building a router");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+template <typename StopCondition, typename ArcWeight>
+void DijkstraRouter<Weight>::RunSearch(State& state, VertexId from, StopCondition should_stop,
+                                       ArcWeight arc_weight) const {
+    state.Start();
+    state.Relax(from, ZERO_WEIGHT, NO_EDGE);
+
+    while (!state.IsQueueEmpty()) {
+        const VertexId vertex = state.PopMin();
+        if (should_stop(vertex)) {
+            break;
+        }
+
+        const Weight weight = state.GetWeight(vertex);
+        for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+            state.Relax(arc.vertex, weight + arc_weight(arc), arc.edge_id);
+        }
+    }
+    settled_count_ = state.GetSettledCount();
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo>
+DijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    CheckVertex(from);
+    CheckVertex(to);
+
+    const StateLease state = AcquireState();
+    RunSearch(*state, from, [to](VertexId vertex) {
+        return vertex == to;
+    });
+    if (!state->IsReached(to)) {
+        return std::nullopt;
+    }
+    return ExtractRoute(*state, to);
+}
+
+template <typename Weight>
+template <typename EdgeWeight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo>
+DijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to, EdgeWeight edge_weight) const {
+    CheckVertex(from);
+    CheckVertex(to);
+
+    const StateLease state = AcquireState();
+    RunSearch(*state, from, [to](VertexId vertex) {
+        return vertex == to;
+    }, [&edge_weight](const Arc<Weight>& arc) {
+        return edge_weight(arc.edge_id);
+    });
+    if (!state->IsReached(to)) {
+        return std::nullopt;
+    }
+    return ExtractRoute(*state, to);
+}
+
+template <typename Weight>
+std::vector<std::optional<typename DijkstraRouter<Weight>::RouteInfo>>
+DijkstraRouter<Weight>::BuildRoutes(VertexId from, const std::vector<VertexId>& targets) const {
+    CheckVertex(from);
+    for (const VertexId target : targets) {
+        CheckVertex(target);
+    }
+
+    std::vector<VertexId> pending_targets = targets;
+    std::sort(pending_targets.begin(), pending_targets.end());
+    pending_targets.erase(std::unique(pending_targets.begin(), pending_targets.end()),
+                          pending_targets.end());
+    size_t pending_count = pending_targets.size();
+
+    const StateLease state = AcquireState();
+    RunSearch(*state, from, [&](VertexId vertex) {
+        if (std::binary_search(pending_targets.begin(), pending_targets.end(), vertex)) {
+            --pending_count;
+        }
+        return pending_count == 0;
+    });
+
+    std::vector<std::optional<RouteInfo>> routes;
+    routes.reserve(targets.size());
+    for (const VertexId target : targets) {
+        if (state->IsReached(target)) {
+            routes.push_back(ExtractRoute(*state, target));
+        } else {
+            routes.push_back(std::nullopt);
+        }
+    }
+    return routes;
+}
+
+template <typename Weight>
+std::vector<std::pair<VertexId, Weight>> DijkstraRouter<Weight>::FindReachable(
+    VertexId from, Weight max_weight) const {
+    CheckVertex(from);
+
+    std::vector<std::pair<VertexId, Weight>> reachable;
+    const StateLease state = AcquireState();
+    RunSearch(*state, from, [&](VertexId vertex) {
+        const Weight weight = state->GetWeight(vertex);
+        if (max_weight < weight) {
+            return true;
+        }
+        reachable.emplace_back(vertex, weight);
+        return false;
+    });
+    return reachable;
+}
+
+template <typename Weight>
+typename DijkstraRouter<Weight>::RouteInfo DijkstraRouter<Weight>::ExtractRoute(
+    const State& state, VertexId to) const {
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = state.GetPrevEdge(to); edge_id != NO_EDGE;
+         edge_id = state.GetPrevEdge(graph_.GetEdge(edge_id).from)) {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{state.GetWeight(to), std::move(edges)};
+}
+
+template <typename Weight>
+void DijkstraRouter<Weight>::BuildTree(VertexId root, ShortestPathTree<Weight>& tree) const {
+    CheckVertex(root);
+
+    const StateLease state = AcquireState();
+    RunSearch(*state, root, [](VertexId) {
+        return false;
+    });
+
+    const size_t vertex_count = graph_.GetVertexCount();
+    tree.root = root;
+    tree.weights.assign(vertex_count, ZERO_WEIGHT);
+    tree.prev_edges.assign(vertex_count, NO_EDGE);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        if (state->IsReached(vertex)) {
+            tree.weights[vertex] = state->GetWeight(vertex);
+            tree.prev_edges[vertex] = state->GetPrevEdge(vertex);
+        }
+    }
+}
+
+}  // namespace graph
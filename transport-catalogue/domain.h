@@ -6,23 +6,31 @@
 #include <memory>
 #include <variant>
 #include <chrono>
+#include <cstdint>
 #include "geo.h"
 
 namespace domain {
 
+// Плотные номера, выдаваемые справочником по порядку добавления: по ним
+// данные об остановках и автобусах хранятся в векторах, а не в словарях по указателю
+using StopId = uint32_t;
+using BusId = uint32_t;
+
 struct Stop {
     std::string name;
     geo::Coordinates coordinates;
+    StopId id = 0;
 };
 
 struct Bus {
     std::string name;
     std::vector<const Stop*> stops;
     bool is_roundtrip;
+    BusId id = 0;
     
     Bus() = default;
-    Bus(std::string n, std::vector<const Stop*> s, bool r)
-        : name(std::move(n)), stops(std::move(s)), is_roundtrip(r) {}
+    Bus(std::string n, std::vector<const Stop*> s, bool r, BusId i = 0)
+        : name(std::move(n)), stops(std::move(s)), is_roundtrip(r), id(i) {}
 };
 
 struct RouteInfo {
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "graph.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace graph::detail {
+
+inline constexpr EdgeId NO_TABLE_EDGE = std::numeric_limits<EdgeId>::max();
+
+// Обновление готовой таблицы кратчайших путей всех пар после правки графа
+// без полного пересчёта. Table — адаптер таблицы конкретного маршрутизатора:
+//   size_t GetVertexCount() const;
+//   bool IsReachable(VertexId from, VertexId to) const;
+//   Weight GetWeight(VertexId from, VertexId to) const;
+//   EdgeId GetPrevEdge(VertexId from, VertexId to) const;  // NO_TABLE_EDGE — путь без рёбер
+//   void Set(VertexId from, VertexId to, Weight weight, EdgeId prev_edge);
+//   void Clear(VertexId from, VertexId to);  // пара недостижима
+// Граф к моменту обновления уже содержит добавленные рёбра и не содержит
+// удалённых, таблица расширена до числа вершин графа. Строки таблицы
+// обновляются параллельно: каждая задача пишет только в свою строку.
+template <typename Weight, typename Table>
+class AllPairsUpdater {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    AllPairsUpdater(const Graph& graph, Table& table, parallel::ThreadPool& pool)
+        : graph_(graph)
+        , table_(table)
+        , pool_(pool)
+        , vertex_count_(graph.GetVertexCount()) {
+    }
+
+    void Update(const std::vector<EdgeId>& added_edges, const std::vector<EdgeId>& removed_edges) {
+        std::vector<char> is_added(graph_.GetEdgeCount(), false);
+        for (const EdgeId edge_id : added_edges) {
+            is_added[edge_id] = true;
+        }
+        RemoveEdges(removed_edges, is_added);
+        InsertEdges(added_edges);
+    }
+
+private:
+    // В строках, в деревьях путей которых есть удалённые рёбра, пересчитываются
+    // только вершины поддеревьев под удалёнными рёбрами: их пути начинаются
+    // с входящих рёбер из остальных вершин, расстояния до которых не изменились.
+    // Добавленные рёбра при этом не учитываются, и таблица становится точной
+    // для исходного графа без удалённых рёбер
+    void RemoveEdges(const std::vector<EdgeId>& removed_edges, const std::vector<char>& is_added) {
+        if (removed_edges.empty()) {
+            return;
+        }
+        std::vector<char> is_removed(graph_.GetEdgeCount(), false);
+        for (const EdgeId edge_id : removed_edges) {
+            is_removed[edge_id] = true;
+        }
+        pool_.ParallelFor(vertex_count_, [&](VertexId from, size_t) {
+            for (VertexId to = 0; to < vertex_count_; ++to) {
+                const EdgeId prev_edge = table_.IsReachable(from, to) ? table_.GetPrevEdge(from, to)
+                                                                      : NO_TABLE_EDGE;
+                if (prev_edge != NO_TABLE_EDGE && is_removed[prev_edge]) {
+                    RepairRow(from, is_removed, is_added);
+                    return;
+                }
+            }
+        });
+    }
+
+    void RepairRow(VertexId from, const std::vector<char>& is_removed,
+                   const std::vector<char>& is_added) {
+        enum Status : char { UNKNOWN, INTACT, AFFECTED };
+        std::vector<char> status(vertex_count_, UNKNOWN);
+        std::vector<VertexId> affected;
+        std::vector<VertexId> chain;
+
+        // Вершина затронута, если путь к ней в дереве строки проходит удалённое ребро
+        status[from] = INTACT;
+        for (VertexId to = 0; to < vertex_count_; ++to) {
+            VertexId vertex = to;
+            while (status[vertex] == UNKNOWN) {
+                const EdgeId prev_edge = table_.IsReachable(from, vertex)
+                                             ? table_.GetPrevEdge(from, vertex) : NO_TABLE_EDGE;
+                if (prev_edge == NO_TABLE_EDGE) {
+                    status[vertex] = INTACT;
+                } else if (is_removed[prev_edge]) {
+                    status[vertex] = AFFECTED;
+                    affected.push_back(vertex);
+                } else {
+                    chain.push_back(vertex);
+                    vertex = graph_.GetEdge(prev_edge).from;
+                }
+            }
+            for (const VertexId chained : chain) {
+                status[chained] = status[vertex];
+                if (status[vertex] == AFFECTED) {
+                    affected.push_back(chained);
+                }
+            }
+            chain.clear();
+        }
+
+        using Entry = std::pair<Weight, VertexId>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        for (const VertexId vertex : affected) {
+            table_.Clear(from, vertex);
+        }
+        for (const VertexId vertex : affected) {
+            for (const auto& arc : graph_.GetIncomingArcs(vertex)) {
+                if (!is_added[arc.edge_id] && status[arc.vertex] == INTACT
+                    && table_.IsReachable(from, arc.vertex)) {
+                    Relax(from, vertex, table_.GetWeight(from, arc.vertex) + arc.weight,
+                          arc.edge_id, queue);
+                }
+            }
+        }
+
+        // Дейкстра по затронутым вершинам
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (status[vertex] != AFFECTED) {
+                continue;
+            }
+            status[vertex] = INTACT;
+            for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+                if (!is_added[arc.edge_id] && status[arc.vertex] == AFFECTED) {
+                    Relax(from, arc.vertex, weight + arc.weight, arc.edge_id, queue);
+                }
+            }
+        }
+    }
+
+    template <typename Queue>
+    void Relax(VertexId from, VertexId to, Weight candidate, EdgeId edge_id, Queue& queue) {
+        if (!table_.IsReachable(from, to) || candidate < table_.GetWeight(from, to)) {
+            table_.Set(from, to, candidate, edge_id);
+            queue.push({candidate, to});
+        }
+    }
+
+    // Рёбра вставляются группами по начальной вершине u. Кратчайший путь,
+    // использующий новые рёбра из u, проходит u один раз, поэтому сначала
+    // улучшается строка u: d[u][j] = min(d[u][j], w(u, v) + d[v][j]), а затем
+    // для каждой строки i, из которой достижима u, — только изменившиеся
+    // столбцы строки u: d[i][j] = min(d[i][j], d[i][u] + d[u][j])
+    void InsertEdges(std::vector<EdgeId> added_edges) {
+        std::stable_sort(added_edges.begin(), added_edges.end(), [this](EdgeId lhs, EdgeId rhs) {
+            return graph_.GetEdge(lhs).from < graph_.GetEdge(rhs).from;
+        });
+
+        std::vector<VertexId> changed;
+        for (auto group_begin = added_edges.begin(); group_begin != added_edges.end();) {
+            const VertexId through = graph_.GetEdge(*group_begin).from;
+            const auto group_end = std::find_if(group_begin, added_edges.end(),
+                                                [this, through](EdgeId edge_id) {
+                                                    return graph_.GetEdge(edge_id).from != through;
+                                                });
+
+            changed.clear();
+            for (auto it = group_begin; it != group_end; ++it) {
+                RelaxSourceRow(*it, changed);
+            }
+            std::sort(changed.begin(), changed.end());
+            changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+            if (!changed.empty()) {
+                pool_.ParallelFor(vertex_count_, [&](VertexId from, size_t) {
+                    if (from != through && table_.IsReachable(from, through)) {
+                        RelaxRowThrough(from, through, changed);
+                    }
+                });
+            }
+            group_begin = group_end;
+        }
+    }
+
+    void RelaxSourceRow(EdgeId edge_id, std::vector<VertexId>& changed) {
+        const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+        if (edge.from == edge.to) {
+            return;
+        }
+        for (VertexId to = 0; to < vertex_count_; ++to) {
+            if (!table_.IsReachable(edge.to, to)) {
+                continue;
+            }
+            const Weight candidate = edge.weight + table_.GetWeight(edge.to, to);
+            if (!table_.IsReachable(edge.from, to) || candidate < table_.GetWeight(edge.from, to)) {
+                const EdgeId prev_edge = table_.GetPrevEdge(edge.to, to);
+                table_.Set(edge.from, to, candidate,
+                           prev_edge != NO_TABLE_EDGE ? prev_edge : edge_id);
+                changed.push_back(to);
+            }
+        }
+    }
+
+    void RelaxRowThrough(VertexId from, VertexId through, const std::vector<VertexId>& changed) {
+        const Weight weight_to_through = table_.GetWeight(from, through);
+        for (const VertexId to : changed) {
+            const Weight candidate = weight_to_through + table_.GetWeight(through, to);
+            if (!table_.IsReachable(from, to) || candidate < table_.GetWeight(from, to)) {
+                table_.Set(from, to, candidate, table_.GetPrevEdge(through, to));
+            }
+        }
+    }
+
+    const Graph& graph_;
+    Table& table_;
+    parallel::ThreadPool& pool_;
+    size_t vertex_count_;
+};
+
+}  // namespace graph::detail
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Таблица кратчайших путей между всеми парами вершин в одном непрерывном
+// массиве (строка на вершину-источник). Вместо optional используются
+// значения-метки: бесконечный вес для недостижимой пары и NO_EDGE
+// для пути без рёбер. Пара занимает sizeof(StoredWeight) + 4 байта.
+// Таблица может быть представлением внешней памяти (например, отображённого
+// файла): такая таблица только читается, память должна её пережить.
+template <typename StoredWeight>
+class FlatRouteTable {
+    static_assert(std::numeric_limits<StoredWeight>::has_infinity,
+                  "Stored weight should have an infinity value");
+
+public:
+    static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+    static constexpr StoredWeight UNREACHABLE = std::numeric_limits<StoredWeight>::infinity();
+
+    FlatRouteTable() = default;
+
+    explicit FlatRouteTable(size_t vertex_count)
+        : vertex_count_(vertex_count)
+        , weights_(vertex_count * vertex_count, UNREACHABLE)
+        , prev_edges_(vertex_count * vertex_count, NO_EDGE) {
+    }
+
+    FlatRouteTable(size_t vertex_count, const StoredWeight* weights, const uint32_t* prev_edges)
+        : vertex_count_(vertex_count)
+        , external_weights_(weights)
+        , external_prev_edges_(prev_edges) {
+    }
+
+    bool IsView() const {
+        return external_weights_ != nullptr;
+    }
+
+    size_t GetVertexCount() const {
+        return vertex_count_;
+    }
+
+    StoredWeight* GetWeightRow(VertexId from) {
+        return weights_.data() + from * vertex_count_;
+    }
+
+    const StoredWeight* GetWeightRow(VertexId from) const {
+        return GetWeights() + from * vertex_count_;
+    }
+
+    uint32_t* GetPrevEdgeRow(VertexId from) {
+        return prev_edges_.data() + from * vertex_count_;
+    }
+
+    const uint32_t* GetPrevEdgeRow(VertexId from) const {
+        return GetPrevEdges() + from * vertex_count_;
+    }
+
+    // Меняет число вершин, сохраняя пути между прежними вершинами; новые пары
+    // недостижимы. Таблица-представление при этом копируется в собственную память
+    void Resize(size_t vertex_count) {
+        std::vector<StoredWeight> weights(vertex_count * vertex_count, UNREACHABLE);
+        std::vector<uint32_t> prev_edges(vertex_count * vertex_count, NO_EDGE);
+        const size_t kept_count = std::min(vertex_count, vertex_count_);
+        const FlatRouteTable& old_table = *this;
+        for (VertexId from = 0; from < kept_count; ++from) {
+            std::copy_n(old_table.GetWeightRow(from), kept_count, weights.data() + from * vertex_count);
+            std::copy_n(old_table.GetPrevEdgeRow(from), kept_count,
+                        prev_edges.data() + from * vertex_count);
+        }
+        vertex_count_ = vertex_count;
+        weights_ = std::move(weights);
+        prev_edges_ = std::move(prev_edges);
+        external_weights_ = nullptr;
+        external_prev_edges_ = nullptr;
+    }
+
+    size_t GetMemoryUsage() const {
+        return vertex_count_ * vertex_count_ * (sizeof(StoredWeight) + sizeof(uint32_t));
+    }
+
+private:
+    const StoredWeight* GetWeights() const {
+        return IsView() ? external_weights_ : weights_.data();
+    }
+
+    const uint32_t* GetPrevEdges() const {
+        return IsView() ? external_prev_edges_ : prev_edges_.data();
+    }
+
+    size_t vertex_count_ = 0;
+    std::vector<StoredWeight> weights_;
+    std::vector<uint32_t> prev_edges_;
+    const StoredWeight* external_weights_ = nullptr;
+    const uint32_t* external_prev_edges_ = nullptr;
+};
+
+}  // namespace graph
@@ -2,7 +2,9 @@
 
 #include "ranges.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <stdexcept>
 #include <vector>
 
 namespace graph {
@@ -17,43 +19,180 @@ struct Edge {
     Weight weight;
 };
 
+// Ребро в CSR-представлении замороженного графа: соседняя вершина
+// (to для исходящих рёбер, from для входящих), вес и исходный EdgeId
+template <typename Weight>
+struct Arc {
+    VertexId vertex;
+    Weight weight;
+    EdgeId edge_id;
+};
+
+// Граф строится добавлением рёбер, затем замораживается методом Freeze():
+// рёбра каждой вершины раскладываются подряд в сжатый массив строк (CSR),
+// и обход соседей становится последовательным чтением без обращений к edges_.
+// Маршрутизаторы работают только с замороженным графом. Чтобы изменить
+// замороженный граф, его размораживают методом Thaw(), правят и снова
+// замораживают; EdgeId существующих рёбер при этом не меняются.
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
     using IncidenceList = std::vector<EdgeId>;
-    using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+    using IncidentEdgesRange = ranges::Range<const EdgeId*>;
+    using ArcsRange = ranges::Range<const Arc<Weight>*>;
 
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    // Резервирует место ещё под count рёбер
+    void ReserveEdges(size_t count);
+    // Добавляет count вершин без рёбер и возвращает первую из них
+    VertexId AddVertices(size_t count);
+    // Исключает ребро из списков смежности; его EdgeId не переиспользуется
+    void RemoveEdge(EdgeId edge_id);
+
+    // Переводит граф в CSR-представление; после этого граф менять нельзя
+    void Freeze();
+    // Возвращает граф к спискам смежности для правки
+    void Thaw();
+    bool IsFrozen() const;
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+    IncidentEdgesRange GetIncomingEdges(VertexId vertex) const;
+
+    // Только для замороженного графа, вершина не проверяется
+    ArcsRange GetOutgoingArcs(VertexId vertex) const;
+    ArcsRange GetIncomingArcs(VertexId vertex) const;
 
 private:
+    // Рёбра, сгруппированные по вершине: рёбра вершины v лежат
+    // в arcs[offsets[v]] .. arcs[offsets[v + 1]] в порядке добавления
+    struct CompressedRows {
+        std::vector<size_t> offsets;
+        std::vector<Arc<Weight>> arcs;
+        std::vector<EdgeId> edge_ids;
+    };
+
+    CompressedRows Compress(const std::vector<IncidenceList>& lists, bool outgoing) const;
+
+    size_t vertex_count_ = 0;
+    bool frozen_ = false;
     std::vector<Edge<Weight>> edges_;
     std::vector<IncidenceList> incidence_lists_;
+    std::vector<IncidenceList> incoming_lists_;
+    CompressedRows outgoing_;
+    CompressedRows incoming_;
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : vertex_count_(vertex_count)
+    , incidence_lists_(vertex_count)
+    , incoming_lists_(vertex_count) {
 }
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    if (frozen_) {
+        throw std::logic_error("Cannot add an edge to a frozen graph");
+    }
     edges_.push_back(edge);
     const EdgeId id = edges_.size() - 1;
     incidence_lists_.at(edge.from).push_back(id);
+    incoming_lists_.at(edge.to).push_back(id);
     return id;
 }
 
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::ReserveEdges(size_t count) {
+    edges_.reserve(edges_.size() + count);
+}
+
+template <typename Weight>
+VertexId DirectedWeightedGraph<Weight>::AddVertices(size_t count) {
+    if (frozen_) {
+        throw std::logic_error("Cannot add a vertex to a frozen graph");
+    }
+    const VertexId first = vertex_count_;
+    vertex_count_ += count;
+    incidence_lists_.resize(vertex_count_);
+    incoming_lists_.resize(vertex_count_);
+    return first;
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::RemoveEdge(EdgeId edge_id) {
+    if (frozen_) {
+        throw std::logic_error("Cannot remove an edge from a frozen graph");
+    }
+    const Edge<Weight>& edge = edges_.at(edge_id);
+    for (IncidenceList* list : {&incidence_lists_[edge.from], &incoming_lists_[edge.to]}) {
+        list->erase(std::remove(list->begin(), list->end(), edge_id), list->end());
+    }
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Freeze() {
+    if (frozen_) {
+        return;
+    }
+    outgoing_ = Compress(incidence_lists_, true);
+    incoming_ = Compress(incoming_lists_, false);
+    incidence_lists_ = {};
+    incoming_lists_ = {};
+    frozen_ = true;
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Thaw() {
+    if (!frozen_) {
+        return;
+    }
+    incidence_lists_.assign(vertex_count_, {});
+    incoming_lists_.assign(vertex_count_, {});
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        incidence_lists_[vertex].assign(outgoing_.edge_ids.begin() + outgoing_.offsets[vertex],
+                                        outgoing_.edge_ids.begin() + outgoing_.offsets[vertex + 1]);
+        incoming_lists_[vertex].assign(incoming_.edge_ids.begin() + incoming_.offsets[vertex],
+                                       incoming_.edge_ids.begin() + incoming_.offsets[vertex + 1]);
+    }
+    outgoing_ = {};
+    incoming_ = {};
+    frozen_ = false;
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::CompressedRows
+DirectedWeightedGraph<Weight>::Compress(const std::vector<IncidenceList>& lists,
+                                        bool outgoing) const {
+    CompressedRows rows;
+    rows.offsets.reserve(vertex_count_ + 1);
+    rows.arcs.reserve(edges_.size());
+    rows.edge_ids.reserve(edges_.size());
+    rows.offsets.push_back(0);
+    for (const IncidenceList& list : lists) {
+        for (const EdgeId edge_id : list) {
+            const Edge<Weight>& edge = edges_[edge_id];
+            rows.arcs.push_back({outgoing ? edge.to : edge.from, edge.weight, edge_id});
+            rows.edge_ids.push_back(edge_id);
+        }
+        rows.offsets.push_back(rows.arcs.size());
+    }
+    return rows;
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+    return frozen_;
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return vertex_count_;
 }
 
 template <typename Weight>
@@ -63,12 +202,42 @@ size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const {
 
 template <typename Weight>
 const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-    return edges_.at(edge_id);
+    return edges_[edge_id];
 }
 
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-    return ranges::AsRange(incidence_lists_.at(vertex));
+    if (frozen_) {
+        const EdgeId* ids = outgoing_.edge_ids.data();
+        return {ids + outgoing_.offsets.at(vertex), ids + outgoing_.offsets[vertex + 1]};
+    }
+    const IncidenceList& list = incidence_lists_.at(vertex);
+    return {list.data(), list.data() + list.size()};
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
+DirectedWeightedGraph<Weight>::GetIncomingEdges(VertexId vertex) const {
+    if (frozen_) {
+        const EdgeId* ids = incoming_.edge_ids.data();
+        return {ids + incoming_.offsets.at(vertex), ids + incoming_.offsets[vertex + 1]};
+    }
+    const IncidenceList& list = incoming_lists_.at(vertex);
+    return {list.data(), list.data() + list.size()};
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::ArcsRange
+DirectedWeightedGraph<Weight>::GetOutgoingArcs(VertexId vertex) const {
+    const Arc<Weight>* arcs = outgoing_.arcs.data();
+    return {arcs + outgoing_.offsets[vertex], arcs + outgoing_.offsets[vertex + 1]};
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::ArcsRange
+DirectedWeightedGraph<Weight>::GetIncomingArcs(VertexId vertex) const {
+    const Arc<Weight>* arcs = incoming_.arcs.data();
+    return {arcs + incoming_.offsets[vertex], arcs + incoming_.offsets[vertex + 1]};
 }
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
@@ -0,0 +1,403 @@
+#pragma once
+
+#include "astar_router.h"
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Метки хабов: у каждой вершины v исходящая метка — хабы h с весом пути v -> h,
+// входящая — хабы с весом пути h -> v, по возрастанию номера хаба. Для любой
+// пары вершин общий хаб их меток лежит на кратчайшем пути, и вес пути —
+// минимум суммы весов по общим хабам, то есть слияние двух коротких массивов.
+// Метки хранятся одним плоским блоком, который пишется в файл как есть;
+// представление внешнего блока (например, отображённого файла) только читается,
+// память должна его пережить.
+template <typename Weight>
+class HubLabels {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+
+    HubLabels() = default;
+    HubLabels(const HubLabels&) = delete;
+    HubLabels& operator=(const HubLabels&) = delete;
+    HubLabels(HubLabels&&) = default;
+    HubLabels& operator=(HubLabels&&) = default;
+
+    // Построение отсечёнными поисками Дейкстры (pruned landmark labeling)
+    // из вершин по убыванию важности
+    explicit HubLabels(const Graph& graph);
+
+    // Представление блока из GetBlob; nullopt, если размеры блока не сходятся
+    // или метки не могут быть метками графа (см. проверки в FromBlob)
+    static std::optional<HubLabels> FromBlob(const char* data, size_t size);
+
+    const char* GetBlobData() const {
+        return blob_;
+    }
+
+    size_t GetBlobSize() const {
+        return blob_size_;
+    }
+
+    size_t GetVertexCount() const {
+        return vertex_count_;
+    }
+
+    // Среднее число хабов в метке вершины по обоим направлениям
+    double GetAverageLabelSize() const;
+
+    // Вес кратчайшего пути; UNREACHABLE, если пути нет
+    Weight GetWeight(VertexId from, VertexId to) const;
+
+private:
+    // Начало блока; за ним uint64_t[V + 1] смещений исходящих и входящих меток,
+    // веса исходящих и входящих меток и номера их хабов (uint32_t).
+    // Блок выравнивается по 8 байтам
+    struct BlobHeader {
+        uint64_t vertex_count;
+        uint64_t out_entry_count;
+        uint64_t in_entry_count;
+        uint64_t weight_size;
+    };
+
+    struct Entry {
+        uint32_t hub;
+        Weight weight;
+    };
+    using Label = std::vector<Entry>;
+
+    // Смещения массивов от начала блока
+    struct BlobLayout {
+        size_t out_offsets = 0;
+        size_t in_offsets = 0;
+        size_t out_weights = 0;
+        size_t in_weights = 0;
+        size_t out_hubs = 0;
+        size_t in_hubs = 0;
+        size_t size = 0;
+    };
+
+    static BlobLayout ComputeBlobLayout(const BlobHeader& header);
+    void BuildBlob(const std::vector<Label>& out_labels, const std::vector<Label>& in_labels);
+    void Attach(const char* blob, size_t size);
+
+    size_t vertex_count_ = 0;
+    std::vector<uint64_t> storage_;
+    const char* blob_ = nullptr;
+    size_t blob_size_ = 0;
+    const uint64_t* out_offsets_ = nullptr;
+    const uint64_t* in_offsets_ = nullptr;
+    const Weight* out_weights_ = nullptr;
+    const Weight* in_weights_ = nullptr;
+    const uint32_t* out_hubs_ = nullptr;
+    const uint32_t* in_hubs_ = nullptr;
+};
+
+template <typename Weight>
+HubLabels<Weight>::HubLabels(const Graph& graph)
+    : vertex_count_(graph.GetVertexCount()) {
+    // Важность вершины — произведение степеней: через вершины, где сходится
+    // и расходится много рёбер, проходит больше кратчайших путей
+    std::vector<VertexId> order(vertex_count_);
+    std::vector<uint64_t> importance(vertex_count_);
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        order[vertex] = vertex;
+        const auto outgoing = graph.GetOutgoingArcs(vertex);
+        const auto incoming = graph.GetIncomingArcs(vertex);
+        importance[vertex] = static_cast<uint64_t>(outgoing.end() - outgoing.begin() + 1)
+                           * static_cast<uint64_t>(incoming.end() - incoming.begin() + 1);
+    }
+    std::stable_sort(order.begin(), order.end(), [&importance](VertexId lhs, VertexId rhs) {
+        return importance[lhs] > importance[rhs];
+    });
+
+    // Хаб метки — ранг вершины, поэтому метки растут в порядке номеров хабов.
+    // Поиск из хаба с рангом rank не продолжается через вершину, путь до которой
+    // уже покрыт хабами меньшего ранга
+    std::vector<Label> out_labels(vertex_count_);
+    std::vector<Label> in_labels(vertex_count_);
+    std::vector<Weight> hub_weights(vertex_count_, UNREACHABLE);
+    detail::SearchState<Weight> state(vertex_count_);
+
+    auto run_pruned_search = [&](uint32_t rank, bool backward) {
+        const VertexId root = order[rank];
+        // Веса root -> h из исходящей метки корня, при обратном поиске —
+        // h -> root из входящей
+        const Label& root_label = backward ? in_labels[root] : out_labels[root];
+        for (const Entry& entry : root_label) {
+            hub_weights[entry.hub] = entry.weight;
+        }
+
+        state.Start();
+        state.Relax(root, Weight{}, detail::SearchState<Weight>::NO_EDGE);
+        while (!state.IsQueueEmpty()) {
+            const VertexId vertex = state.PopMin();
+            const Weight weight = state.GetWeight(vertex);
+            Label& label = backward ? out_labels[vertex] : in_labels[vertex];
+            bool covered = false;
+            for (const Entry& entry : label) {
+                if (hub_weights[entry.hub] != UNREACHABLE
+                    && !(weight < hub_weights[entry.hub] + entry.weight)) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (covered) {
+                continue;
+            }
+            label.push_back({rank, weight});
+            const auto arcs = backward ? graph.GetIncomingArcs(vertex) : graph.GetOutgoingArcs(vertex);
+            for (const auto& arc : arcs) {
+                state.Relax(arc.vertex, weight + arc.weight, arc.edge_id);
+            }
+        }
+
+        for (const Entry& entry : root_label) {
+            hub_weights[entry.hub] = UNREACHABLE;
+        }
+    };
+
+    for (uint32_t rank = 0; rank < vertex_count_; ++rank) {
+        run_pruned_search(rank, false);
+        run_pruned_search(rank, true);
+    }
+
+    BuildBlob(out_labels, in_labels);
+}
+
+template <typename Weight>
+typename HubLabels<Weight>::BlobLayout HubLabels<Weight>::ComputeBlobLayout(
+    const BlobHeader& header) {
+    BlobLayout layout;
+    layout.out_offsets = sizeof(BlobHeader);
+    layout.in_offsets = layout.out_offsets + (header.vertex_count + 1) * sizeof(uint64_t);
+    layout.out_weights = layout.in_offsets + (header.vertex_count + 1) * sizeof(uint64_t);
+    layout.in_weights = layout.out_weights + header.out_entry_count * sizeof(Weight);
+    layout.out_hubs = layout.in_weights + header.in_entry_count * sizeof(Weight);
+    layout.in_hubs = layout.out_hubs + header.out_entry_count * sizeof(uint32_t);
+    layout.size = layout.in_hubs + header.in_entry_count * sizeof(uint32_t);
+    return layout;
+}
+
+template <typename Weight>
+void HubLabels<Weight>::BuildBlob(const std::vector<Label>& out_labels,
+                                  const std::vector<Label>& in_labels) {
+    BlobHeader header{vertex_count_, 0, 0, sizeof(Weight)};
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        header.out_entry_count += out_labels[vertex].size();
+        header.in_entry_count += in_labels[vertex].size();
+    }
+    const BlobLayout layout = ComputeBlobLayout(header);
+    storage_.assign((layout.size + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+    char* data = reinterpret_cast<char*>(storage_.data());
+    std::memcpy(data, &header, sizeof(header));
+
+    auto fill = [&](const std::vector<Label>& labels, size_t offsets_position,
+                    size_t weights_position, size_t hubs_position) {
+        auto* offsets = reinterpret_cast<uint64_t*>(data + offsets_position);
+        auto* weights = reinterpret_cast<Weight*>(data + weights_position);
+        auto* hubs = reinterpret_cast<uint32_t*>(data + hubs_position);
+        uint64_t position = 0;
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            offsets[vertex] = position;
+            for (const Entry& entry : labels[vertex]) {
+                weights[position] = entry.weight;
+                hubs[position] = entry.hub;
+                ++position;
+            }
+        }
+        offsets[vertex_count_] = position;
+    };
+    fill(out_labels, layout.out_offsets, layout.out_weights, layout.out_hubs);
+    fill(in_labels, layout.in_offsets, layout.in_weights, layout.in_hubs);
+    Attach(data, layout.size);
+}
+
+template <typename Weight>
+void HubLabels<Weight>::Attach(const char* blob, size_t size) {
+    BlobHeader header;
+    std::memcpy(&header, blob, sizeof(header));
+    const BlobLayout layout = ComputeBlobLayout(header);
+    vertex_count_ = header.vertex_count;
+    blob_ = blob;
+    blob_size_ = size;
+    out_offsets_ = reinterpret_cast<const uint64_t*>(blob + layout.out_offsets);
+    in_offsets_ = reinterpret_cast<const uint64_t*>(blob + layout.in_offsets);
+    out_weights_ = reinterpret_cast<const Weight*>(blob + layout.out_weights);
+    in_weights_ = reinterpret_cast<const Weight*>(blob + layout.in_weights);
+    out_hubs_ = reinterpret_cast<const uint32_t*>(blob + layout.out_hubs);
+    in_hubs_ = reinterpret_cast<const uint32_t*>(blob + layout.in_hubs);
+}
+
+template <typename Weight>
+std::optional<HubLabels<Weight>> HubLabels<Weight>::FromBlob(const char* data, size_t size) {
+    BlobHeader header;
+    if (size < sizeof(header)) {
+        return std::nullopt;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.weight_size != sizeof(Weight)
+        || header.vertex_count > size / sizeof(uint64_t)
+        || header.out_entry_count > size || header.in_entry_count > size
+        || ComputeBlobLayout(header).size != size) {
+        return std::nullopt;
+    }
+
+    HubLabels labels;
+    labels.Attach(data, size);
+    // Смещения проверяются, чтобы слияние меток не вышло за блок. Хабы метки —
+    // ранги вершин, строго по возрастанию; веса неотрицательны (и не NaN), иначе
+    // слияние даёт неверный вес, а оценка A* в HubLabelRouter — завышенную
+    for (const auto& [offsets, weights, hubs, entry_count] :
+         {std::tuple{labels.out_offsets_, labels.out_weights_, labels.out_hubs_, header.out_entry_count},
+          std::tuple{labels.in_offsets_, labels.in_weights_, labels.in_hubs_, header.in_entry_count}}) {
+        if (offsets[0] != 0 || offsets[header.vertex_count] != entry_count) {
+            return std::nullopt;
+        }
+        for (VertexId vertex = 0; vertex < header.vertex_count; ++vertex) {
+            if (offsets[vertex + 1] < offsets[vertex]) {
+                return std::nullopt;
+            }
+            for (uint64_t position = offsets[vertex]; position < offsets[vertex + 1]; ++position) {
+                if (hubs[position] >= header.vertex_count
+                    || (position > offsets[vertex] && hubs[position] <= hubs[position - 1])
+                    || !(weights[position] >= Weight{}) || weights[position] == UNREACHABLE) {
+                    return std::nullopt;
+                }
+            }
+        }
+    }
+    // Хаб на кратчайшем пути из вершины в неё саму есть в обеих её метках:
+    // путь нулевого веса должен найтись слиянием
+    for (VertexId vertex = 0; vertex < header.vertex_count; ++vertex) {
+        if (labels.GetWeight(vertex, vertex) != Weight{}) {
+            return std::nullopt;
+        }
+    }
+    return labels;
+}
+
+template <typename Weight>
+double HubLabels<Weight>::GetAverageLabelSize() const {
+    if (vertex_count_ == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(out_offsets_[vertex_count_] + in_offsets_[vertex_count_])
+         / (2.0 * vertex_count_);
+}
+
+template <typename Weight>
+Weight HubLabels<Weight>::GetWeight(VertexId from, VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    uint64_t out_position = out_offsets_[from];
+    const uint64_t out_end = out_offsets_[from + 1];
+    uint64_t in_position = in_offsets_[to];
+    const uint64_t in_end = in_offsets_[to + 1];
+
+    Weight best = UNREACHABLE;
+    while (out_position < out_end && in_position < in_end) {
+        const uint32_t out_hub = out_hubs_[out_position];
+        const uint32_t in_hub = in_hubs_[in_position];
+        if (out_hub == in_hub) {
+            best = std::min(best, out_weights_[out_position] + in_weights_[in_position]);
+            ++out_position;
+            ++in_position;
+        } else if (out_hub < in_hub) {
+            ++out_position;
+        } else {
+            ++in_position;
+        }
+    }
+    return best;
+}
+
+// Маршрутизатор по меткам хабов: вес пути — слияние меток, а рёбра пути
+// восстанавливаются поиском A*, оценка которого — точный вес из меток,
+// поэтому извлекаются почти только вершины самого пути.
+// Запросы можно вызывать из нескольких потоков.
+template <typename Weight>
+class HubLabelRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+
+    explicit HubLabelRouter(const Graph& graph);
+    // Готовые метки, например загруженные из файла, без предрасчёта
+    HubLabelRouter(const Graph& graph, HubLabels<Weight> labels);
+
+    HubLabelRouter(const HubLabelRouter&) = delete;
+    HubLabelRouter& operator=(const HubLabelRouter&) = delete;
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Только вес пути, без поиска
+    std::optional<Weight> GetWeight(VertexId from, VertexId to) const;
+
+    size_t GetSettledCount() const override {
+        return search_.GetSettledCount();
+    }
+
+    const HubLabels<Weight>& GetLabels() const {
+        return labels_;
+    }
+
+private:
+    HubLabels<Weight> labels_;
+    AStarRouter<Weight> search_;
+};
+
+template <typename Weight>
+HubLabelRouter<Weight>::HubLabelRouter(const Graph& graph)
+    : HubLabelRouter(graph, HubLabels<Weight>(graph)) {
+}
+
+template <typename Weight>
+HubLabelRouter<Weight>::HubLabelRouter(const Graph& graph, HubLabels<Weight> labels)
+    : labels_(std::move(labels))
+    , search_(graph, [this](VertexId vertex, VertexId target) {
+        return labels_.GetWeight(vertex, target);
+    })
+{
+    if (labels_.GetVertexCount() != graph.GetVertexCount()) {
+        throw std::invalid_argument("Hub labels do not match the graph");
+    }
+}
+
+template <typename Weight>
+std::optional<Weight> HubLabelRouter<Weight>::GetWeight(VertexId from, VertexId to) const {
+    const Weight weight = labels_.GetWeight(from, to);
+    if (weight == HubLabels<Weight>::UNREACHABLE) {
+        return std::nullopt;
+    }
+    return weight;
+}
+
+template <typename Weight>
+std::optional<typename HubLabelRouter<Weight>::RouteInfo>
+HubLabelRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (!GetWeight(from, to)) {
+        return std::nullopt;
+    }
+    return search_.BuildRoute(from, to);
+}
+
+}  // namespace graph
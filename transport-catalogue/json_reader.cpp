@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <istream>
 #include <sstream>
 #include <string>
@@ -39,6 +40,7 @@ json::Node JsonReader::LoadDataFromJson() {
     
     if (auto routing_settings = GetRoutingSettings(); routing_settings != nullptr) {
         route_settings_ = ParseRoutingSettings(routing_settings);
+        router_options_ = ParseRouterOptions(routing_settings);
         has_route_settings_ = true;
     }
     
@@ -49,7 +51,8 @@ std::unique_ptr<transport_catalogue::TransportRouter> JsonReader::CreateRouter()
     if (!has_route_settings_) {
         return nullptr;
     }
-    return std::make_unique<transport_catalogue::TransportRouter>(catalogue_, route_settings_);
+    return std::make_unique<transport_catalogue::TransportRouter>(catalogue_, route_settings_,
+                                                                  router_options_);
 }
 
 json::Document JsonReader::HandleJsonRequest(const json::Node& json_request,
@@ -86,7 +89,7 @@ json::Document JsonReader::HandleJsonRequest(const json::Node& json_request,
             } else if (type == "Map"s) {
                 Node response = ProcessMapRequest(id, request_handler);
                 array_context.Value(response.GetValue());
-            } else if (type == "Route"s) {
+            } else if (type == "Route"s || type == "RouteMatrix"s || type == "Reachable"s) {
                 if (!router) {
                     Builder error_builder;
                     error_builder.StartDict()
@@ -94,9 +97,15 @@ json::Document JsonReader::HandleJsonRequest(const json::Node& json_request,
                                .Key("error_message"s).Value("Routing settings not provided"s)
                                .EndDict();
                     array_context.Value(error_builder.Build().GetValue());
-                } else {
+                } else if (type == "Route"s) {
                     Node response = ProcessRouteRequest(request, id, *router);
                     array_context.Value(response.GetValue());
+                } else if (type == "RouteMatrix"s) {
+                    Node response = ProcessRouteMatrixRequest(request, id, *router);
+                    array_context.Value(response.GetValue());
+                } else {
+                    Node response = ProcessReachableRequest(request, id, *router);
+                    array_context.Value(response.GetValue());
                 }
             } else {
                 Builder error_builder;
@@ -165,7 +174,7 @@ json::Node JsonReader::ProcessStopRequest(const json::Dict& request, int id) con
                .Key("error_message"s).Value("not found"s)
                .EndDict();
     } else {
-        auto buses = catalogue_.GetBusesForStop(name);
+        const auto& buses = catalogue_.GetBusesForStop(stop->id);
         
         builder.StartDict()
                .Key("request_id"s).Value(id)
@@ -204,7 +213,42 @@ json::Node JsonReader::ProcessRouteRequest(const json::Dict& request, int id,
     std::string from = request.at("from"s).AsString();
     std::string to = request.at("to"s).AsString();
     
-    auto route_data_opt = router.BuildRoute(from, to);
+    // "items": false — нужен только total_time: с метками хабов он считается без поиска
+    const bool with_items = !request.count("items"s) || request.at("items"s).AsBool();
+    const bool with_override = request.count("bus_wait_time"s) || request.count("bus_velocity"s);
+    if (!with_items && !with_override) {
+        const auto total_time = router.GetRouteTime(from, to);
+        if (!total_time) {
+            builder.StartDict()
+                   .Key("request_id"s).Value(id)
+                   .Key("error_message"s).Value("not found"s)
+                   .EndDict();
+        } else {
+            builder.StartDict()
+                   .Key("request_id"s).Value(id)
+                   .Key("total_time"s).Value(total_time->count())
+                   .EndDict();
+        }
+        return builder.Build();
+    }
+
+    // Необязательные "bus_wait_time" и "bus_velocity" меняют настройки только для этого запроса
+    // Без переопределения ответ из кэша ответов используется как есть, без копии
+    transport_catalogue::TransportRouter::SharedRoute route;
+    if (with_override) {
+        domain::RouteSettings settings = router.GetSettings();
+        if (request.count("bus_wait_time"s)) {
+            settings.bus_wait_time = request.at("bus_wait_time"s).AsInt();
+        }
+        if (request.count("bus_velocity"s)) {
+            settings.bus_velocity = request.at("bus_velocity"s).AsDouble();
+        }
+        route = std::make_shared<const std::optional<transport_catalogue::RouteData>>(
+            router.BuildRoute(from, to, settings));
+    } else {
+        route = router.BuildSharedRoute(from, to);
+    }
+    const auto& route_data_opt = *route;
     
     if (!route_data_opt) {
         builder.StartDict()
@@ -213,33 +257,126 @@ json::Node JsonReader::ProcessRouteRequest(const json::Dict& request, int id,
                .EndDict();
     } else {
         const auto& route_data = *route_data_opt;
+        auto dict_context = builder.StartDict()
+                                   .Key("request_id"s).Value(id)
+                                   .Key("total_time"s).Value(route_data.total_time.count());
+        if (with_items) {
+            dict_context.Key("items"s).Value(MakeRouteItems(route_data).GetValue());
+        }
+        dict_context.EndDict();
+    }
+    
+    return builder.Build();
+}
+
+json::Node JsonReader::ProcessRouteMatrixRequest(const json::Dict& request, int id,
+                                                 transport_catalogue::TransportRouter& router) const {
+    // "from" — одна остановка или массив, "to" — массив остановок
+    auto read_stops = [](const Node& node) {
+        std::vector<std::string_view> stops;
+        if (node.IsString()) {
+            stops.push_back(node.AsString());
+        } else {
+            for (const Node& stop : node.AsArray()) {
+                stops.push_back(stop.AsString());
+            }
+        }
+        return stops;
+    };
+    const std::vector<std::string_view> from = read_stops(request.at("from"s));
+    const std::vector<std::string_view> to = read_stops(request.at("to"s));
+    const bool with_items = request.count("items"s) && request.at("items"s).AsBool();
+
+    const transport_catalogue::RouteMatrix matrix = router.BuildRoutes(from, to, with_items);
+
+    // Строка на источник, null — маршрута нет. Элементы собираются, только
+    // если они запрошены
+    Array total_times;
+    Array items;
+    for (const auto& row : matrix) {
+        Array times_row;
+        Array items_row;
+        for (const auto& route_data : row) {
+            if (route_data) {
+                times_row.emplace_back(route_data->total_time.count());
+            } else {
+                times_row.emplace_back(nullptr);
+            }
+            if (!with_items) {
+                continue;
+            }
+            if (route_data) {
+                items_row.push_back(MakeRouteItems(*route_data));
+            } else {
+                items_row.emplace_back(nullptr);
+            }
+        }
+        total_times.emplace_back(std::move(times_row));
+        if (with_items) {
+            items.emplace_back(std::move(items_row));
+        }
+    }
+
+    Builder builder;
+    auto dict_context = builder.StartDict()
+                               .Key("request_id"s).Value(id)
+                               .Key("total_times"s).Value(std::move(total_times));
+    if (with_items) {
+        dict_context.Key("items"s).Value(std::move(items));
+    }
+    dict_context.EndDict();
+    return builder.Build();
+}
+
+json::Node JsonReader::ProcessReachableRequest(const json::Dict& request, int id,
+                                               transport_catalogue::TransportRouter& router) const {
+    const std::string& from = request.at("from"s).AsString();
+    const transport_catalogue::Minutes max_time(request.at("max_time"s).AsDouble());
+
+    Builder builder;
+    if (!catalogue_.GetStop(from)) {
         builder.StartDict()
                .Key("request_id"s).Value(id)
-               .Key("total_time"s).Value(route_data.total_time.count())
-               .Key("items"s).StartArray();
-        
-        for (const auto& item : route_data.items) {
-            if (std::holds_alternative<WaitItem>(item)) {
-                const auto& wait_item = std::get<WaitItem>(item);
-                builder.StartDict()
-                       .Key("type"s).Value("Wait"s)
-                       .Key("stop_name"s).Value(wait_item.stop_name)
-                       .Key("time"s).Value(wait_item.time)
-                       .EndDict();
-            } else if (std::holds_alternative<BusItem>(item)) {
-                const auto& bus_item = std::get<BusItem>(item);
-                builder.StartDict()
-                       .Key("type"s).Value("Bus"s)
-                       .Key("bus"s).Value(bus_item.bus)
-                       .Key("span_count"s).Value(bus_item.span_count)
-                       .Key("time"s).Value(bus_item.time)
-                       .EndDict();
-            }
+               .Key("error_message"s).Value("not found"s)
+               .EndDict();
+        return builder.Build();
+    }
+
+    auto stops_context = builder.StartDict()
+                                .Key("request_id"s).Value(id)
+                                .Key("stops"s).StartArray();
+    for (const auto& [stop, time] : router.FindReachable(from, max_time)) {
+        stops_context.StartDict()
+                     .Key("stop_name"s).Value(stop->name)
+                     .Key("time"s).Value(time.count())
+                     .EndDict();
+    }
+    stops_context.EndArray().EndDict();
+    return builder.Build();
+}
+
+json::Node JsonReader::MakeRouteItems(const transport_catalogue::RouteData& route_data) const {
+    Builder builder;
+    auto array_context = builder.StartArray();
+    for (const auto& item : route_data.items) {
+        if (std::holds_alternative<WaitItem>(item)) {
+            const auto& wait_item = std::get<WaitItem>(item);
+            array_context.StartDict()
+                         .Key("type"s).Value("Wait"s)
+                         .Key("stop_name"s).Value(wait_item.stop_name)
+                         .Key("time"s).Value(wait_item.time)
+                         .EndDict();
+        } else {
+            const auto& bus_item = std::get<BusItem>(item);
+            array_context.StartDict()
+                         .Key("type"s).Value("Bus"s)
+                         .Key("bus"s).Value(bus_item.bus)
+                         .Key("span_count"s).Value(bus_item.span_count)
+                         .Key("time"s).Value(bus_item.time)
+                         .EndDict();
         }
-        
-        builder.EndArray().EndDict();
     }
-    
+    array_context.EndArray();
     return builder.Build();
 }
 
@@ -407,4 +544,130 @@ domain::RouteSettings JsonReader::ParseRoutingSettings(const Node& root) const {
     return settings;
 }
 
+transport_catalogue::RouterOptions JsonReader::ParseRouterOptions(const Node& root) const {
+    using transport_catalogue::RouterType;
+    transport_catalogue::RouterOptions options;
+    const json::Dict& settings_dict = root.AsMap();
+
+    // Необязательный ключ "router" выбирает алгоритм поиска маршрута
+    if (settings_dict.count("router"s)) {
+        const std::string& name = settings_dict.at("router"s).AsString();
+        if (name == "all_pairs"s) {
+            options.type = RouterType::ALL_PAIRS;
+        } else if (name == "compact_all_pairs"s) {
+            options.type = RouterType::COMPACT_ALL_PAIRS;
+        } else if (name == "dijkstra"s) {
+            options.type = RouterType::DIJKSTRA;
+        } else if (name == "bidirectional"s) {
+            options.type = RouterType::BIDIRECTIONAL;
+        } else if (name == "astar"s) {
+            options.type = RouterType::ASTAR;
+        } else if (name == "contraction_hierarchy"s) {
+            options.type = RouterType::CONTRACTION_HIERARCHY;
+        } else if (name == "hub_labels"s) {
+            options.type = RouterType::HUB_LABELS;
+        } else if (name == "alt"s) {
+            options.type = RouterType::ALT;
+        } else if (name == "overlay"s) {
+            options.type = RouterType::OVERLAY;
+        } else if (name == "raptor"s) {
+            options.type = RouterType::RAPTOR;
+        } else {
+            throw std::invalid_argument("Unknown router type: "s + name);
+        }
+    }
+
+    // Необязательный бюджет кэша деревьев кратчайших путей в мегабайтах
+    if (settings_dict.count("tree_cache_mb"s)) {
+        const double megabytes = settings_dict.at("tree_cache_mb"s).AsDouble();
+        options.tree_cache_bytes = static_cast<size_t>(std::max(megabytes, 0.0) * 1024 * 1024);
+    }
+
+    if (settings_dict.count("precompute_threads"s)) {
+        options.precompute_threads = static_cast<size_t>(
+            std::max(settings_dict.at("precompute_threads"s).AsInt(), 0));
+    }
+
+    // Необязательный путь к файлу кэша графа и таблиц маршрутизатора
+    if (settings_dict.count("cache_file"s)) {
+        options.cache_path = settings_dict.at("cache_file"s).AsString();
+    }
+
+    // Необязательный кэш готовых ответов Route и пары остановок для его прогрева:
+    // "answer_cache_size": N, "answer_cache_warm_up": [["from", "to"], ...]
+    if (settings_dict.count("answer_cache_size"s)) {
+        options.answer_cache_size = static_cast<size_t>(
+            std::max(settings_dict.at("answer_cache_size"s).AsInt(), 0));
+    }
+    if (settings_dict.count("answer_cache_warm_up"s)) {
+        for (const Node& pair : settings_dict.at("answer_cache_warm_up"s).AsArray()) {
+            const json::Array& stops = pair.AsArray();
+            options.answer_cache_warm_up.emplace_back(stops.at(0).AsString(),
+                                                      stops.at(1).AsString());
+        }
+    }
+
+    // Необязательный ключ "all_pairs_method": "auto" (по умолчанию),
+    // "floyd_warshall" или "dijkstra"
+    if (settings_dict.count("all_pairs_method"s)) {
+        const std::string& name = settings_dict.at("all_pairs_method"s).AsString();
+        if (name == "auto"s) {
+            options.all_pairs_method = graph::AllPairsMethod::AUTO;
+        } else if (name == "floyd_warshall"s) {
+            options.all_pairs_method = graph::AllPairsMethod::FLOYD_WARSHALL;
+        } else if (name == "dijkstra"s) {
+            options.all_pairs_method = graph::AllPairsMethod::DIJKSTRA;
+        } else {
+            throw std::invalid_argument("Unknown all-pairs method: "s + name);
+        }
+    }
+
+    // Необязательный ключ "graph_model": "span_edges" (по умолчанию) или "linear"
+    if (settings_dict.count("graph_model"s)) {
+        const std::string& name = settings_dict.at("graph_model"s).AsString();
+        if (name == "span_edges"s) {
+            options.graph_model = transport_catalogue::GraphModel::SPAN_EDGES;
+        } else if (name == "linear"s) {
+            options.graph_model = transport_catalogue::GraphModel::LINEAR_RIDES;
+        } else {
+            throw std::invalid_argument("Unknown graph model: "s + name);
+        }
+    }
+
+    // Ориентиры маршрутизатора "alt": "landmark_count": N,
+    // "landmark_selection": "avoid" (по умолчанию) или "farthest"
+    if (settings_dict.count("landmark_count"s)) {
+        options.landmark_count = static_cast<size_t>(
+            std::max(settings_dict.at("landmark_count"s).AsInt(), 1));
+    }
+    if (settings_dict.count("landmark_selection"s)) {
+        const std::string& name = settings_dict.at("landmark_selection"s).AsString();
+        if (name == "avoid"s) {
+            options.landmark_selection = graph::LandmarkSelection::AVOID;
+        } else if (name == "farthest"s) {
+            options.landmark_selection = graph::LandmarkSelection::FARTHEST;
+        } else {
+            throw std::invalid_argument("Unknown landmark selection: "s + name);
+        }
+    }
+
+    // Разбиение маршрутизатора "overlay": "overlay_cell_size": N вершин в ячейке
+    // нижнего уровня, "overlay_levels": N уровней
+    if (settings_dict.count("overlay_cell_size"s)) {
+        options.overlay_cell_size = static_cast<size_t>(
+            std::max(settings_dict.at("overlay_cell_size"s).AsInt(), 1));
+    }
+    if (settings_dict.count("overlay_levels"s)) {
+        options.overlay_level_count = static_cast<size_t>(
+            std::max(settings_dict.at("overlay_levels"s).AsInt(), 1));
+    }
+
+    // Необязательное слияние параллельных рёбер графа "span_edges"
+    if (settings_dict.count("dedup_parallel_edges"s)) {
+        options.dedup_parallel_edges = settings_dict.at("dedup_parallel_edges"s).AsBool();
+    }
+
+    return options;
+}
+
 } // namespace json_reader
\ No newline at end of file
@@ -45,6 +45,11 @@ private:
                                  request_handler::RequestHandler& request_handler) const;
     json::Node ProcessRouteRequest(const json::Dict& request, int id,
                                    transport_catalogue::TransportRouter& router) const;
+    json::Node ProcessRouteMatrixRequest(const json::Dict& request, int id,
+                                         transport_catalogue::TransportRouter& router) const;
+    json::Node ProcessReachableRequest(const json::Dict& request, int id,
+                                       transport_catalogue::TransportRouter& router) const;
+    json::Node MakeRouteItems(const transport_catalogue::RouteData& route_data) const;
     
     void ParseBaseRequests(transport_catalogue::TransportCatalogue& catalogue) const;
     void ParseStops(transport_catalogue::TransportCatalogue& catalogue, 
@@ -56,6 +61,7 @@ private:
     
     renderer::RenderSettings ParseRenderSettings(const json::Node& root) const;
     domain::RouteSettings ParseRoutingSettings(const json::Node& root) const;
+    transport_catalogue::RouterOptions ParseRouterOptions(const json::Node& root) const;
     svg::Color ParseColor(const json::Node& color_node) const;
     
     json::Document doc_input_;
@@ -63,6 +69,7 @@ private:
     renderer::MapRenderer& render_;
     json::Node null_node_{nullptr};
     domain::RouteSettings route_settings_;
+    transport_catalogue::RouterOptions router_options_;
     bool has_route_settings_ = false;
 };
 
@@ -1,6 +1,5 @@
 #include "map_renderer.h"
 #include <vector>
-#include <map>
 #include <string_view>
 #include <algorithm>
 
@@ -11,12 +10,12 @@ bool IsZero(double value) {
 }
 
 std::vector<svg::Polyline> MapRenderer::GetRouteLines(
-    const std::map<std::string_view, const domain::Bus*>& buses,
+    const std::vector<const domain::Bus*>& buses,
     const SphereProjector& sp) const {
     std::vector<svg::Polyline> result;
     size_t color_num = 0;
     
-    for (const auto& [bus_number, bus] : buses) {
+    for (const domain::Bus* bus : buses) {
         if (bus->stops.empty()) continue;
         
         std::vector<const domain::Stop*> route_stops{
@@ -53,25 +52,13 @@ std::vector<svg::Polyline> MapRenderer::GetRouteLines(
 }
 
 std::vector<svg::Text> MapRenderer::GetNameBusRoute(
-    const std::map<std::string_view, const domain::Bus*>& buses,
+    const std::vector<const domain::Bus*>& buses,
     const SphereProjector& sp) const {  // Исправлено: добавлен const &
     
     std::vector<svg::Text> result;
     size_t color_num = 0;
     
-    std::vector<std::pair<std::string_view, const domain::Bus*>> sorted_buses;
-    sorted_buses.reserve(buses.size());
-    
-    for (const auto& [bus_name, bus] : buses) {
-        sorted_buses.emplace_back(bus_name, bus);
-    }
-    
-    std::sort(sorted_buses.begin(), sorted_buses.end(),
-              [](const auto& lhs, const auto& rhs) {
-                  return lhs.first < rhs.first;
-              });
-    
-    for (const auto& [bus_name, bus] : sorted_buses) {
+    for (const domain::Bus* bus : buses) {
         if (bus->stops.empty()) {
             continue;
         }
@@ -98,7 +85,7 @@ std::vector<svg::Text> MapRenderer::GetNameBusRoute(
                 .SetFontSize(render_settings_.bus_label_font_size)
                 .SetFontFamily("Verdana")
                 .SetFontWeight("bold")
-                .SetData(std::string(bus_name))
+                .SetData(bus->name)
                 .SetFillColor(render_settings_.underlayer_color)
                 .SetStrokeColor(render_settings_.underlayer_color)
                 .SetStrokeWidth(render_settings_.underlayer_width)
@@ -111,7 +98,7 @@ std::vector<svg::Text> MapRenderer::GetNameBusRoute(
                 .SetFontSize(render_settings_.bus_label_font_size)
                 .SetFontFamily("Verdana")
                 .SetFontWeight("bold")
-                .SetData(std::string(bus_name))
+                .SetData(bus->name)
                 .SetFillColor(bus_color);
             
             result.push_back(std::move(underlayer));
@@ -129,12 +116,12 @@ std::vector<svg::Text> MapRenderer::GetNameBusRoute(
 }
 
 std::vector<svg::Circle> MapRenderer::GetStopsSymbols(
-    const std::map<std::string_view, const domain::Stop*>& stops,
+    const std::vector<const domain::Stop*>& stops,
     const SphereProjector& sp) const {
     
     std::vector<svg::Circle> result;
     
-    for (const auto& [stop_name, stop] : stops) {
+    for (const domain::Stop* stop : stops) {
         svg::Point stop_point = sp(stop->coordinates);
         
         svg::Circle circle;
@@ -149,26 +136,15 @@ std::vector<svg::Circle> MapRenderer::GetStopsSymbols(
 }
 
 std::vector<svg::Text> MapRenderer::GetStopsLabels(
-    const std::map<std::string_view, const domain::Stop*>& stops,
+    const std::vector<const domain::Stop*>& stops,
     const SphereProjector& sp) const {
     
     std::vector<svg::Text> result;
     
-    std::vector<std::pair<std::string_view, const domain::Stop*>> sorted_stops;
-    sorted_stops.reserve(stops.size());
-    
-    for (const auto& [stop_name, stop] : stops) {
-        if (!stop->name.empty()) {
-            sorted_stops.emplace_back(stop_name, stop);
+    for (const domain::Stop* stop : stops) {
+        if (stop->name.empty()) {
+            continue;
         }
-    }
-    
-    std::sort(sorted_stops.begin(), sorted_stops.end(),
-              [](const auto& lhs, const auto& rhs) {
-                  return lhs.first < rhs.first;
-              });
-    
-    for (const auto& [stop_name, stop] : sorted_stops) {
         svg::Point stop_point = sp(stop->coordinates);
         
         svg::Text underlayer;
@@ -176,7 +152,7 @@ std::vector<svg::Text> MapRenderer::GetStopsLabels(
             .SetOffset(render_settings_.stop_label_offset)
             .SetFontSize(render_settings_.stop_label_font_size)
             .SetFontFamily("Verdana")
-            .SetData(std::string(stop_name))
+            .SetData(stop->name)
             .SetFillColor(render_settings_.underlayer_color)
             .SetStrokeColor(render_settings_.underlayer_color)
             .SetStrokeWidth(render_settings_.underlayer_width)
@@ -188,7 +164,7 @@ std::vector<svg::Text> MapRenderer::GetStopsLabels(
             .SetOffset(render_settings_.stop_label_offset)
             .SetFontSize(render_settings_.stop_label_font_size)
             .SetFontFamily("Verdana")
-            .SetData(std::string(stop_name))
+            .SetData(stop->name)
             .SetFillColor("black");
         
         result.push_back(std::move(underlayer));
@@ -199,18 +175,30 @@ std::vector<svg::Text> MapRenderer::GetStopsLabels(
 }
 
 svg::Document MapRenderer::GetSVG(
-    const std::map<std::string_view, const domain::Bus*>& buses) const {
+    const std::vector<const domain::Bus*>& buses) const {
     
     svg::Document result;
     std::vector<geo::Coordinates> route_stops_coord;
-    std::map<std::string_view, const domain::Stop*> all_stops;
+    std::vector<const domain::Stop*> all_stops;
+    // Остановки, уже попавшие в all_stops, по StopId
+    std::vector<char> is_added;
     
-    for (const auto& [bus_number, bus] : buses) {
+    for (const domain::Bus* bus : buses) {
         for (const auto& stop : bus->stops) {
             route_stops_coord.push_back(stop->coordinates);
-            all_stops[stop->name] = stop;
+            if (stop->id >= is_added.size()) {
+                is_added.resize(stop->id + 1, false);
+            }
+            if (!is_added[stop->id]) {
+                is_added[stop->id] = true;
+                all_stops.push_back(stop);
+            }
         }
     }
+    std::sort(all_stops.begin(), all_stops.end(),
+              [](const domain::Stop* lhs, const domain::Stop* rhs) {
+                  return lhs->name < rhs->name;
+              });
     
     SphereProjector sp(route_stops_coord.begin(),
                        route_stops_coord.end(),
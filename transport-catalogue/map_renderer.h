@@ -94,24 +94,24 @@ public:
         render_settings_ = render_settings;
     }
     
-    svg::Document GetSVG(const std::map<std::string_view, 
-                         const domain::Bus*>& buses) const;
+    // Автобусы — в порядке имён: в нём назначаются цвета маршрутов
+    svg::Document GetSVG(const std::vector<const domain::Bus*>& buses) const;
     
 private:
     std::vector<svg::Polyline> GetRouteLines(
-        const std::map<std::string_view, const domain::Bus*>& buses,
+        const std::vector<const domain::Bus*>& buses,
         const SphereProjector& sp) const;
     
     std::vector<svg::Text> GetNameBusRoute(
-        const std::map<std::string_view, const domain::Bus*>& buses,
+        const std::vector<const domain::Bus*>& buses,
         const SphereProjector& sp) const;
     
     std::vector<svg::Circle> GetStopsSymbols(
-        const std::map<std::string_view, const domain::Stop*>& stops,
+        const std::vector<const domain::Stop*>& stops,
         const SphereProjector& sp) const;
     
     std::vector<svg::Text> GetStopsLabels(
-        const std::map<std::string_view, const domain::Stop*>& stops,
+        const std::vector<const domain::Stop*>& stops,
         const SphereProjector& sp) const;
     
     RenderSettings render_settings_;
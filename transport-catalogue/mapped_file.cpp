@@ -0,0 +1,63 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <utility>
+
+namespace io {
+
+MappedFile::MappedFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file " + path);
+    }
+
+    struct stat file_stat {};
+    if (::fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map empty file " + path);
+    }
+
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // Отображение остаётся действительным и после закрытия дескриптора
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map file " + path);
+    }
+
+    data_ = static_cast<const char*>(data);
+    size_ = size;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+void MappedFile::Close() {
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+} // namespace io
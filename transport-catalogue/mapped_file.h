@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace io {
+
+// Файл, отображённый в память только для чтения (mmap). Страницы подгружаются
+// по обращению и разделяются между процессами, открывшими тот же файл.
+// Открытие бросает std::runtime_error, если файл нельзя открыть или отобразить.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    bool IsOpen() const {
+        return data_ != nullptr;
+    }
+
+    const char* GetData() const {
+        return data_;
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+private:
+    void Close();
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace io
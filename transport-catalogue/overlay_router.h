@@ -0,0 +1,662 @@
+#pragma once
+
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+#include "state_pool.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Веса оверлея для одной метрики: веса рёбер графа и shortcut клик ячеек.
+// Строится фазой настройки OverlayRouter::Customize
+template <typename Weight>
+struct OverlayMetric {
+    // По EdgeId; пусто — веса рёбер графа
+    std::vector<Weight> edge_weights;
+    // По уровням: матрицы клик ячеек подряд, строка матрицы — веса путей
+    // из граничной вершины ячейки во все её граничные вершины
+    std::vector<std::vector<Weight>> clique_weights;
+};
+
+// Многоуровневый оверлей в духе CRP. Предрасчёт делится на две фазы.
+// Разбиение зависит только от структуры графа: граф рекурсивно делится
+// пополам по порядку обхода в ширину из псевдопериферийной вершины
+// (сбалансированный разделитель по уровням BFS). Ячейки уровня 1 — не больше
+// cell_size вершин, ячейка уровня k + 1 объединяет до LEVEL_FANOUT ячеек
+// уровня k. Граничная вершина ячейки — вершина с ребром в другую ячейку того
+// же уровня. Настройка зависит от весов: для каждой ячейки считаются пути
+// между всеми её граничными вершинами внутри ячейки (клика shortcut) по
+// кликам уровнем ниже; ячейки уровня обрабатываются параллельно.
+// Запрос — поиск Дейкстры, который в ячейках без from и to на самом высоком
+// таком уровне идёт только по клике и рёбрам, выходящим из ячейки.
+// Shortcut на найденном пути разворачиваются поиском внутри своей ячейки.
+// Запросы можно вызывать из нескольких потоков: каждый берёт свои рабочие
+// массивы из пула. Update вызывается, когда запросов нет.
+template <typename Weight>
+class OverlayRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+    using Metric = OverlayMetric<Weight>;
+    using EdgeWeight = std::function<Weight(EdgeId)>;
+
+    static constexpr size_t LEVEL_FANOUT = 8;
+
+    // Разбиение и настройка для весов графа на thread_count потоках (0 — по числу ядер)
+    OverlayRouter(const Graph& graph, size_t cell_size, size_t level_count,
+                  size_t thread_count = 0);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Запрос по метрике из Customize
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to, const Metric& metric) const;
+
+    // Фаза настройки для весов рёбер edge_weight при том же разбиении
+    Metric Customize(const EdgeWeight& edge_weight) const;
+
+    // После правки графа (граф уже снова заморожен): прежние вершины остаются
+    // в своих ячейках, новые попадают в ячейки соседей. Пересчитываются
+    // граничные вершины и метрика весов графа, разбиение не повторяется
+    void Update();
+
+    // Число вершин, извлечённых последним завершённым запросом
+    size_t GetSettledCount() const override {
+        return settled_count_;
+    }
+
+    size_t GetLevelCount() const {
+        return levels_.size();
+    }
+
+    size_t GetCellCount(size_t level) const {
+        return levels_.at(level - 1).cell_count;
+    }
+
+    size_t GetBoundaryCount(size_t level) const {
+        return levels_.at(level - 1).boundary_vertices.size();
+    }
+
+private:
+    static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+    static constexpr EdgeId NO_EDGE = detail::SearchState<Weight>::NO_EDGE;
+    static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::max();
+
+    // Уровень разбиения; levels_[k] — уровень k + 1
+    struct Level {
+        std::vector<uint32_t> cells;  // ячейка вершины
+        size_t cell_count = 0;
+        // Граничные вершины ячеек по возрастанию в формате CSR
+        std::vector<size_t> boundary_offsets;
+        std::vector<VertexId> boundary_vertices;
+        // Номер вершины среди граничных вершин её ячейки; NO_INDEX — не граничная
+        std::vector<uint32_t> boundary_index;
+        // Начало матрицы клики ячейки в clique_weights уровня, cell_count + 1 значений
+        std::vector<size_t> clique_offsets;
+        // Рёбра из граничной вершины в другие ячейки по порядку boundary_vertices
+        // в формате CSR: в графе маршрутов большинство рёбер остаётся в ячейке
+        std::vector<size_t> exit_offsets;
+        std::vector<EdgeId> exit_edges;
+    };
+
+    // Рабочие массивы запроса: поиск по оверлею и разворачивание shortcut
+    struct Search {
+        explicit Search(size_t vertex_count)
+            : state(vertex_count)
+            , unpack_state(vertex_count) {
+        }
+
+        detail::SearchState<Weight> state;
+        detail::SearchState<Weight> unpack_state;
+    };
+
+    // Рабочие массивы разбиения
+    struct PartitionScratch {
+        std::vector<uint32_t> member_stamps;
+        std::vector<uint32_t> visited_stamps;
+        uint32_t generation = 0;
+        std::vector<VertexId> order;
+    };
+
+    void Partition(size_t cell_size, size_t level_count);
+    void Split(std::vector<VertexId>& vertices, size_t begin, size_t end, size_t level,
+               std::vector<uint32_t> open_cells, const std::vector<size_t>& max_sizes,
+               PartitionScratch& scratch);
+    // Переставляет вершины диапазона в порядке BFS; возвращает середину
+    size_t Bisect(std::vector<VertexId>& vertices, size_t begin, size_t end,
+                  PartitionScratch& scratch) const;
+    // Обход в ширину по рёбрам без учёта направления внутри отмеченных вершин;
+    // возвращает последнюю посещённую вершину
+    VertexId RunPartitionBfs(VertexId root, PartitionScratch& scratch) const;
+
+    void BuildBoundaries();
+    void CustomizeCliques(Metric& metric) const;
+    void CustomizeCell(size_t level, uint32_t cell, Metric& metric,
+                       detail::SearchState<Weight>& state) const;
+
+    // Уровень, на котором поиск проходит вершину: наибольший k, при котором
+    // её ячейки уровней 1..k не содержат ни from, ни to; 0 — рёбра графа
+    size_t GetQueryLevel(VertexId vertex, VertexId from, VertexId to) const;
+
+    // visit(vertex, weight, edge_id) для дуг вершины на уровне level: на уровне 0 —
+    // все исходящие рёбра, иначе клика её ячейки и рёбра, выходящие из ячейки.
+    // EdgeId дуги клики — число рёбер графа плюс её номер среди всех дуг клик
+    template <typename Visit>
+    void ForEachArc(VertexId vertex, size_t level, const Metric& metric, Visit&& visit) const;
+
+    Weight GetEdgeWeight(const Metric& metric, EdgeId edge_id, Weight graph_weight) const {
+        return metric.edge_weights.empty() ? graph_weight : metric.edge_weights[edge_id];
+    }
+
+    // Дописывает в edges рёбра графа кратчайшего пути from -> to внутри ячейки
+    // уровня level, которой принадлежат обе вершины
+    void AppendCellPath(size_t level, VertexId from, VertexId to, const Metric& metric,
+                        detail::SearchState<Weight>& state, std::vector<EdgeId>& edges) const;
+
+    const Graph& graph_;
+    size_t thread_count_;
+    std::vector<Level> levels_;
+    // Начало дуг клик уровня в нумерации дуг клик, levels_.size() + 1 значений
+    std::vector<size_t> clique_arc_begin_;
+    Metric metric_;
+    parallel::StatePool<Search> searches_;
+    mutable std::atomic<size_t> settled_count_ = 0;
+};
+
+template <typename Weight>
+OverlayRouter<Weight>::OverlayRouter(const Graph& graph, size_t cell_size, size_t level_count,
+                                     size_t thread_count)
+    : graph_(graph)
+    , thread_count_(thread_count)
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building a router");
+    }
+    if (cell_size == 0 || level_count == 0) {
+        throw std::invalid_argument("Overlay needs at least one level of non-empty cells");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    Partition(cell_size, level_count);
+    BuildBoundaries();
+    CustomizeCliques(metric_);
+}
+
+template <typename Weight>
+void OverlayRouter<Weight>::Partition(size_t cell_size, size_t level_count) {
+    const size_t vertex_count = graph_.GetVertexCount();
+    levels_.assign(level_count, Level{});
+    for (Level& level : levels_) {
+        level.cells.assign(vertex_count, NO_INDEX);
+    }
+    if (vertex_count == 0) {
+        return;
+    }
+
+    std::vector<size_t> max_sizes(level_count);
+    max_sizes[0] = cell_size;
+    for (size_t level = 1; level < level_count; ++level) {
+        max_sizes[level] = max_sizes[level - 1] * LEVEL_FANOUT;
+    }
+
+    std::vector<VertexId> vertices(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        vertices[vertex] = vertex;
+    }
+    PartitionScratch scratch;
+    scratch.member_stamps.assign(vertex_count, 0);
+    scratch.visited_stamps.assign(vertex_count, 0);
+    Split(vertices, 0, vertex_count, level_count, std::vector<uint32_t>(level_count, NO_INDEX),
+          max_sizes, scratch);
+}
+
+template <typename Weight>
+void OverlayRouter<Weight>::Split(std::vector<VertexId>& vertices, size_t begin, size_t end,
+                                  size_t level, std::vector<uint32_t> open_cells,
+                                  const std::vector<size_t>& max_sizes,
+                                  PartitionScratch& scratch) {
+    // Часть становится ячейкой всех ещё не назначенных уровней, в размер
+    // которых она помещается: так ячейки уровней вложены друг в друга
+    const size_t size = end - begin;
+    while (level > 0 && size <= max_sizes[level - 1]) {
+        open_cells[level - 1] = static_cast<uint32_t>(levels_[level - 1].cell_count++);
+        --level;
+    }
+    if (level == 0) {
+        for (size_t index = begin; index < end; ++index) {
+            for (size_t k = 0; k < levels_.size(); ++k) {
+                levels_[k].cells[vertices[index]] = open_cells[k];
+            }
+        }
+        return;
+    }
+
+    const size_t middle = Bisect(vertices, begin, end, scratch);
+    Split(vertices, begin, middle, level, open_cells, max_sizes, scratch);
+    Split(vertices, middle, end, level, std::move(open_cells), max_sizes, scratch);
+}
+
+template <typename Weight>
+size_t OverlayRouter<Weight>::Bisect(std::vector<VertexId>& vertices, size_t begin, size_t end,
+                                     PartitionScratch& scratch) const {
+    if (++scratch.generation == 0) {
+        std::fill(scratch.member_stamps.begin(), scratch.member_stamps.end(), 0);
+        std::fill(scratch.visited_stamps.begin(), scratch.visited_stamps.end(), 0);
+        scratch.generation = 1;
+    }
+    for (size_t index = begin; index < end; ++index) {
+        scratch.member_stamps[vertices[index]] = scratch.generation;
+    }
+
+    // Первый обход находит вершину на краю части, второй из неё упорядочивает
+    // вершины по удалению: первая половина порядка отделяется от второй
+    // по одному слою BFS. Несвязные куски части обходятся следом
+    scratch.order.clear();
+    const VertexId peripheral = RunPartitionBfs(vertices[begin], scratch);
+    if (++scratch.generation == 0) {
+        std::fill(scratch.member_stamps.begin(), scratch.member_stamps.end(), 0);
+        std::fill(scratch.visited_stamps.begin(), scratch.visited_stamps.end(), 0);
+        scratch.generation = 1;
+    }
+    for (size_t index = begin; index < end; ++index) {
+        scratch.member_stamps[vertices[index]] = scratch.generation;
+    }
+    scratch.order.clear();
+    RunPartitionBfs(peripheral, scratch);
+    for (size_t index = begin; index < end; ++index) {
+        if (scratch.visited_stamps[vertices[index]] != scratch.generation) {
+            RunPartitionBfs(vertices[index], scratch);
+        }
+    }
+    std::copy(scratch.order.begin(), scratch.order.end(), vertices.begin() + begin);
+    return begin + (end - begin) / 2;
+}
+
+template <typename Weight>
+VertexId OverlayRouter<Weight>::RunPartitionBfs(VertexId root, PartitionScratch& scratch) const {
+    const size_t first = scratch.order.size();
+    scratch.visited_stamps[root] = scratch.generation;
+    scratch.order.push_back(root);
+    for (size_t index = first; index < scratch.order.size(); ++index) {
+        const VertexId vertex = scratch.order[index];
+        for (const auto arcs : {graph_.GetOutgoingArcs(vertex), graph_.GetIncomingArcs(vertex)}) {
+            for (const auto& arc : arcs) {
+                if (scratch.member_stamps[arc.vertex] == scratch.generation
+                    && scratch.visited_stamps[arc.vertex] != scratch.generation) {
+                    scratch.visited_stamps[arc.vertex] = scratch.generation;
+                    scratch.order.push_back(arc.vertex);
+                }
+            }
+        }
+    }
+    return scratch.order.back();
+}
+
+template <typename Weight>
+void OverlayRouter<Weight>::BuildBoundaries() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    clique_arc_begin_.assign(1, 0);
+    for (Level& level : levels_) {
+        const auto& cells = level.cells;
+        level.boundary_index.assign(vertex_count, NO_INDEX);
+        std::vector<char> is_boundary(vertex_count, false);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+                if (cells[arc.vertex] != cells[vertex]) {
+                    is_boundary[vertex] = true;
+                    is_boundary[arc.vertex] = true;
+                }
+            }
+        }
+
+        level.boundary_offsets.assign(level.cell_count + 1, 0);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (is_boundary[vertex]) {
+                ++level.boundary_offsets[cells[vertex] + 1];
+            }
+        }
+        for (size_t cell = 0; cell < level.cell_count; ++cell) {
+            level.boundary_offsets[cell + 1] += level.boundary_offsets[cell];
+        }
+        level.boundary_vertices.resize(level.boundary_offsets.back());
+        std::vector<size_t> positions(level.boundary_offsets.begin(),
+                                      level.boundary_offsets.end() - 1);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (is_boundary[vertex]) {
+                const uint32_t cell = cells[vertex];
+                level.boundary_index[vertex] =
+                    static_cast<uint32_t>(positions[cell] - level.boundary_offsets[cell]);
+                level.boundary_vertices[positions[cell]++] = vertex;
+            }
+        }
+
+        level.exit_offsets.assign(1, 0);
+        level.exit_edges.clear();
+        for (const VertexId vertex : level.boundary_vertices) {
+            for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+                if (cells[arc.vertex] != cells[vertex]) {
+                    level.exit_edges.push_back(arc.edge_id);
+                }
+            }
+            level.exit_offsets.push_back(level.exit_edges.size());
+        }
+
+        level.clique_offsets.assign(level.cell_count + 1, 0);
+        for (size_t cell = 0; cell < level.cell_count; ++cell) {
+            const size_t boundary_count =
+                level.boundary_offsets[cell + 1] - level.boundary_offsets[cell];
+            level.clique_offsets[cell + 1] =
+                level.clique_offsets[cell] + boundary_count * boundary_count;
+        }
+        clique_arc_begin_.push_back(clique_arc_begin_.back() + level.clique_offsets.back());
+    }
+}
+
+template <typename Weight>
+typename OverlayRouter<Weight>::Metric OverlayRouter<Weight>::Customize(
+    const EdgeWeight& edge_weight) const {
+    Metric metric;
+    metric.edge_weights.resize(graph_.GetEdgeCount());
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        metric.edge_weights[edge_id] = edge_weight(edge_id);
+        if (metric.edge_weights[edge_id] < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    CustomizeCliques(metric);
+    return metric;
+}
+
+template <typename Weight>
+void OverlayRouter<Weight>::CustomizeCliques(Metric& metric) const {
+    parallel::ThreadPool pool(thread_count_);
+    std::vector<detail::SearchState<Weight>> states;
+    states.reserve(pool.GetThreadCount());
+    for (size_t worker = 0; worker < pool.GetThreadCount(); ++worker) {
+        states.emplace_back(graph_.GetVertexCount());
+    }
+
+    // Клики уровня k + 1 считаются по кликам уровня k
+    metric.clique_weights.assign(levels_.size(), {});
+    for (size_t level = 1; level <= levels_.size(); ++level) {
+        metric.clique_weights[level - 1].assign(levels_[level - 1].clique_offsets.back(),
+                                                UNREACHABLE);
+        pool.ParallelFor(levels_[level - 1].cell_count, [&](size_t cell, size_t worker) {
+            CustomizeCell(level, static_cast<uint32_t>(cell), metric, states[worker]);
+        });
+    }
+}
+
+template <typename Weight>
+void OverlayRouter<Weight>::CustomizeCell(size_t level, uint32_t cell, Metric& metric,
+                                          detail::SearchState<Weight>& state) const {
+    const Level& cell_level = levels_[level - 1];
+    const auto& cells = cell_level.cells;
+    const size_t boundary_begin = cell_level.boundary_offsets[cell];
+    const size_t boundary_count = cell_level.boundary_offsets[cell + 1] - boundary_begin;
+    Weight* clique = metric.clique_weights[level - 1].data() + cell_level.clique_offsets[cell];
+
+    // Поиск из каждой граничной вершины по уровню ниже, не выходя из ячейки
+    for (size_t row = 0; row < boundary_count; ++row) {
+        state.Start();
+        state.Relax(cell_level.boundary_vertices[boundary_begin + row], Weight{}, NO_EDGE);
+        while (!state.IsQueueEmpty()) {
+            const VertexId vertex = state.PopMin();
+            const Weight weight = state.GetWeight(vertex);
+            ForEachArc(vertex, level - 1, metric,
+                       [&](VertexId to, Weight arc_weight, EdgeId edge_id) {
+                           if (cells[to] == cell) {
+                               state.Relax(to, weight + arc_weight, edge_id);
+                           }
+                       });
+        }
+        for (size_t column = 0; column < boundary_count; ++column) {
+            const VertexId to = cell_level.boundary_vertices[boundary_begin + column];
+            if (state.IsReached(to)) {
+                clique[row * boundary_count + column] = state.GetWeight(to);
+            }
+        }
+    }
+}
+
+template <typename Weight>
+size_t OverlayRouter<Weight>::GetQueryLevel(VertexId vertex, VertexId from, VertexId to) const {
+    // Ячейка, содержащая from или to, содержит их и на всех уровнях выше
+    size_t level = 0;
+    while (level < levels_.size()) {
+        const auto& cells = levels_[level].cells;
+        if (cells[vertex] == cells[from] || cells[vertex] == cells[to]) {
+            break;
+        }
+        ++level;
+    }
+    return level;
+}
+
+template <typename Weight>
+template <typename Visit>
+void OverlayRouter<Weight>::ForEachArc(VertexId vertex, size_t level, const Metric& metric,
+                                       Visit&& visit) const {
+    if (level == 0) {
+        for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+            visit(arc.vertex, GetEdgeWeight(metric, arc.edge_id, arc.weight), arc.edge_id);
+        }
+        return;
+    }
+
+    // Вершина, через которую поиск идёт на уровне level, всегда граничная:
+    // в её ячейку этого уровня нет пути из from, кроме как через рёбра между ячейками
+    const Level& cell_level = levels_[level - 1];
+    const uint32_t cell = cell_level.cells[vertex];
+    const size_t boundary_begin = cell_level.boundary_offsets[cell];
+    const size_t boundary_count = cell_level.boundary_offsets[cell + 1] - boundary_begin;
+    const size_t row = cell_level.boundary_index[vertex];
+    const size_t row_offset = cell_level.clique_offsets[cell] + row * boundary_count;
+    const Weight* clique = metric.clique_weights[level - 1].data() + row_offset;
+    const EdgeId first_arc = graph_.GetEdgeCount() + clique_arc_begin_[level - 1] + row_offset;
+    for (size_t column = 0; column < boundary_count; ++column) {
+        if (column != row && clique[column] != UNREACHABLE) {
+            visit(cell_level.boundary_vertices[boundary_begin + column], clique[column],
+                  first_arc + column);
+        }
+    }
+    for (size_t exit = cell_level.exit_offsets[boundary_begin + row];
+         exit < cell_level.exit_offsets[boundary_begin + row + 1]; ++exit) {
+        const EdgeId edge_id = cell_level.exit_edges[exit];
+        const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+        visit(edge.to, GetEdgeWeight(metric, edge_id, edge.weight), edge_id);
+    }
+}
+
+template <typename Weight>
+std::optional<typename OverlayRouter<Weight>::RouteInfo> OverlayRouter<Weight>::BuildRoute(
+    VertexId from, VertexId to) const {
+    return BuildRoute(from, to, metric_);
+}
+
+template <typename Weight>
+std::optional<typename OverlayRouter<Weight>::RouteInfo> OverlayRouter<Weight>::BuildRoute(
+    VertexId from, VertexId to, const Metric& metric) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (metric.clique_weights.size() != levels_.size()
+        || (!metric.edge_weights.empty() && metric.edge_weights.size() != graph_.GetEdgeCount())) {
+        throw std::invalid_argument("Metric does not match the overlay");
+    }
+
+    const auto lease = searches_.Acquire([this] {
+        return Search(graph_.GetVertexCount());
+    });
+    detail::SearchState<Weight>& state = lease->state;
+    state.Start();
+    state.Relax(from, Weight{}, NO_EDGE);
+    bool found = false;
+    while (!state.IsQueueEmpty()) {
+        const VertexId vertex = state.PopMin();
+        if (vertex == to) {
+            found = true;
+            break;
+        }
+        const Weight weight = state.GetWeight(vertex);
+        ForEachArc(vertex, GetQueryLevel(vertex, from, to), metric,
+                   [&state, weight](VertexId next, Weight arc_weight, EdgeId edge_id) {
+                       state.Relax(next, weight + arc_weight, edge_id);
+                   });
+    }
+    settled_count_ = state.GetSettledCount();
+    if (!found) {
+        return std::nullopt;
+    }
+
+    // Дуги найденного пути: рёбра графа и shortcut клик (уровень, концы)
+    struct PathArc {
+        EdgeId edge_id;
+        size_t level;
+        VertexId from;
+        VertexId to;
+    };
+    std::vector<PathArc> path;
+    const EdgeId edge_count = graph_.GetEdgeCount();
+    for (VertexId vertex = to; vertex != from;) {
+        const EdgeId edge_id = state.GetPrevEdge(vertex);
+        if (edge_id < edge_count) {
+            path.push_back({edge_id, 0, 0, 0});
+            vertex = graph_.GetEdge(edge_id).from;
+            continue;
+        }
+        const size_t arc = edge_id - edge_count;
+        const size_t level = std::upper_bound(clique_arc_begin_.begin(), clique_arc_begin_.end(),
+                                              arc) - clique_arc_begin_.begin();
+        const Level& cell_level = levels_[level - 1];
+        const size_t offset = arc - clique_arc_begin_[level - 1];
+        const size_t cell = std::upper_bound(cell_level.clique_offsets.begin(),
+                                             cell_level.clique_offsets.end(), offset)
+                            - cell_level.clique_offsets.begin() - 1;
+        const size_t boundary_begin = cell_level.boundary_offsets[cell];
+        const size_t boundary_count = cell_level.boundary_offsets[cell + 1] - boundary_begin;
+        const size_t position = offset - cell_level.clique_offsets[cell];
+        const VertexId arc_from =
+            cell_level.boundary_vertices[boundary_begin + position / boundary_count];
+        path.push_back({NO_EDGE, level, arc_from, vertex});
+        vertex = arc_from;
+    }
+    std::reverse(path.begin(), path.end());
+
+    RouteInfo route{state.GetWeight(to), {}};
+    for (const PathArc& arc : path) {
+        if (arc.edge_id != NO_EDGE) {
+            route.edges.push_back(arc.edge_id);
+        } else {
+            AppendCellPath(arc.level, arc.from, arc.to, metric, lease->unpack_state, route.edges);
+        }
+    }
+    return route;
+}
+
+template <typename Weight>
+void OverlayRouter<Weight>::AppendCellPath(size_t level, VertexId from, VertexId to,
+                                           const Metric& metric,
+                                           detail::SearchState<Weight>& state,
+                                           std::vector<EdgeId>& edges) const {
+    const auto& cells = levels_[level - 1].cells;
+    const uint32_t cell = cells[from];
+    state.Start();
+    state.Relax(from, Weight{}, NO_EDGE);
+    while (!state.IsQueueEmpty()) {
+        const VertexId vertex = state.PopMin();
+        if (vertex == to) {
+            break;
+        }
+        const Weight weight = state.GetWeight(vertex);
+        for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+            if (cells[arc.vertex] == cell) {
+                state.Relax(arc.vertex, weight + GetEdgeWeight(metric, arc.edge_id, arc.weight),
+                            arc.edge_id);
+            }
+        }
+    }
+    if (!state.IsReached(to)) {
+        throw std::logic_error("Overlay shortcut has no path inside its cell");
+    }
+
+    const size_t first = edges.size();
+    for (VertexId vertex = to; vertex != from;) {
+        const EdgeId edge_id = state.GetPrevEdge(vertex);
+        edges.push_back(edge_id);
+        vertex = graph_.GetEdge(edge_id).from;
+    }
+    std::reverse(edges.begin() + first, edges.end());
+}
+
+template <typename Weight>
+void OverlayRouter<Weight>::Update() {
+    if (!graph_.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before updating a router");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        if (graph_.GetEdge(edge_id).weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    const size_t old_vertex_count = levels_.front().cells.size();
+    const size_t vertex_count = graph_.GetVertexCount();
+    for (Level& level : levels_) {
+        level.cells.resize(vertex_count, NO_INDEX);
+    }
+
+    // Новая вершина берёт ячейки соседа; пока соседи есть только среди новых
+    // вершин без ячеек, проход повторяется
+    auto& first_cells = levels_.front().cells;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (VertexId vertex = old_vertex_count; vertex < vertex_count; ++vertex) {
+            if (first_cells[vertex] != NO_INDEX) {
+                continue;
+            }
+            for (const auto arcs : {graph_.GetOutgoingArcs(vertex), graph_.GetIncomingArcs(vertex)}) {
+                for (const auto& arc : arcs) {
+                    if (first_cells[vertex] == NO_INDEX && first_cells[arc.vertex] != NO_INDEX) {
+                        for (Level& level : levels_) {
+                            level.cells[vertex] = level.cells[arc.vertex];
+                        }
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+    // Вершины без рёбер — отдельные ячейки
+    for (VertexId vertex = old_vertex_count; vertex < vertex_count; ++vertex) {
+        if (first_cells[vertex] == NO_INDEX) {
+            for (Level& level : levels_) {
+                level.cells[vertex] = static_cast<uint32_t>(level.cell_count++);
+            }
+        }
+    }
+
+    // Свободные рабочие массивы рассчитаны на прежнее число вершин
+    searches_.Clear();
+    BuildBoundaries();
+    metric_ = Metric{};
+    CustomizeCliques(metric_);
+}
+
+}  // namespace graph
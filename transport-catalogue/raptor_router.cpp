@@ -0,0 +1,221 @@
+#include "raptor_router.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace transport_catalogue {
+
+namespace {
+
+constexpr double UNREACHED = std::numeric_limits<double>::infinity();
+
+} // namespace
+
+RaptorRouter::RaptorRouter(const TransportCatalogue& catalogue,
+                           const domain::RouteSettings& settings)
+    : profile_(MakeProfile(settings)) {
+    // Номер остановки в поиске — её StopId
+    stops_.reserve(catalogue.GetStopCount());
+    for (domain::StopId id = 0; id < catalogue.GetStopCount(); ++id) {
+        stops_.push_back(catalogue.GetStopById(id));
+    }
+
+    // Отрезки идут в том же порядке, в каком TransportRouter добавляет рёбра в граф:
+    // при равном времени выбирается тот же автобус
+    for (const auto& [name, bus] : catalogue.GetBusnameToBus()) {
+        for (const RidePattern& pattern : SplitIntoRidePatterns(catalogue, bus)) {
+            AddPattern(pattern);
+        }
+    }
+    BuildStopIndex();
+}
+
+void RaptorRouter::AddPattern(const RidePattern& ride_pattern) {
+    Pattern pattern;
+    pattern.bus = ride_pattern.bus;
+    pattern.begin = static_cast<uint32_t>(pattern_stops_.size());
+
+    double distance_from_start = 0.0;
+    for (size_t i = 0; i < ride_pattern.stops.size(); ++i) {
+        if (i > 0) {
+            distance_from_start += ride_pattern.distances[i - 1];
+        }
+        pattern_stops_.push_back(GetStopIndex(ride_pattern.stops[i]));
+        pattern_distances_.push_back(distance_from_start);
+    }
+
+    pattern.end = static_cast<uint32_t>(pattern_stops_.size());
+    patterns_.push_back(pattern);
+}
+
+void RaptorRouter::BuildStopIndex() {
+    stop_position_offsets_.assign(stops_.size() + 1, 0);
+    for (const uint32_t stop : pattern_stops_) {
+        ++stop_position_offsets_[stop + 1];
+    }
+    for (size_t stop = 0; stop < stops_.size(); ++stop) {
+        stop_position_offsets_[stop + 1] += stop_position_offsets_[stop];
+    }
+
+    stop_positions_.resize(pattern_stops_.size());
+    std::vector<uint32_t> next_slot(stop_position_offsets_.begin(), stop_position_offsets_.end() - 1);
+    for (uint32_t pattern = 0; pattern < patterns_.size(); ++pattern) {
+        for (uint32_t position = patterns_[pattern].begin; position < patterns_[pattern].end;
+             ++position) {
+            stop_positions_[next_slot[pattern_stops_[position]]++] = {pattern, position};
+        }
+    }
+}
+
+RaptorRouter::Profile RaptorRouter::MakeProfile(const domain::RouteSettings& settings) {
+    return {static_cast<double>(settings.bus_wait_time), settings.bus_velocity * 1000.0 / 60.0};
+}
+
+uint32_t RaptorRouter::GetStopIndex(const domain::Stop* stop) const {
+    if (stop->id >= stops_.size() || stops_[stop->id] != stop) {
+        throw std::out_of_range("Unknown stop");
+    }
+    return stop->id;
+}
+
+void RaptorRouter::RunSearch(Search& search, uint32_t from, uint32_t target,
+                             const Profile& profile) const {
+    search.arrival.assign(stops_.size(), UNREACHED);
+    search.labels.assign(stops_.size(), Label{});
+    search.is_marked.assign(stops_.size(), false);
+    search.first_position.assign(patterns_.size(), NO_INDEX);
+    search.marked_stops.clear();
+    size_t scanned_count = 0;
+
+    search.arrival[from] = 0.0;
+    search.marked_stops.push_back(from);
+    search.is_marked[from] = true;
+
+    while (!search.marked_stops.empty()) {
+        // Отрезки через улучшенные остановки просматриваются с самой ранней из них
+        search.queued_patterns.clear();
+        for (const uint32_t stop : search.marked_stops) {
+            search.is_marked[stop] = false;
+            for (uint32_t slot = stop_position_offsets_[stop];
+                 slot < stop_position_offsets_[stop + 1]; ++slot) {
+                const auto [pattern, position] = stop_positions_[slot];
+                if (search.first_position[pattern] == NO_INDEX) {
+                    search.queued_patterns.push_back(pattern);
+                    search.first_position[pattern] = position;
+                } else {
+                    search.first_position[pattern] =
+                        std::min(search.first_position[pattern], position);
+                }
+            }
+        }
+        search.marked_stops.clear();
+        std::sort(search.queued_patterns.begin(), search.queued_patterns.end());
+
+        for (const uint32_t pattern : search.queued_patterns) {
+            const uint32_t first_position =
+                std::exchange(search.first_position[pattern], NO_INDEX);
+
+            // Лучшая посадка — та, где время прибытия минус путь от начала отрезка минимально
+            uint32_t board_position = NO_INDEX;
+            double board_time = 0.0;
+            double board_key = UNREACHED;
+            for (uint32_t position = first_position; position < patterns_[pattern].end; ++position) {
+                ++scanned_count;
+                const uint32_t stop = pattern_stops_[position];
+                const double distance = pattern_distances_[position];
+
+                if (board_position != NO_INDEX) {
+                    const double arrival = board_time + profile.wait_time
+                        + (distance - pattern_distances_[board_position]) / profile.speed_m_per_min;
+                    const double bound = target == NO_INDEX
+                        ? search.arrival[stop]
+                        : std::min(search.arrival[stop], search.arrival[target]);
+                    if (arrival < bound) {
+                        search.arrival[stop] = arrival;
+                        search.labels[stop] = {pattern, board_position, position};
+                        if (!search.is_marked[stop]) {
+                            search.is_marked[stop] = true;
+                            search.marked_stops.push_back(stop);
+                        }
+                    }
+                }
+
+                if (search.arrival[stop] != UNREACHED) {
+                    const double key = search.arrival[stop] - distance / profile.speed_m_per_min;
+                    if (key < board_key) {
+                        board_position = position;
+                        board_time = search.arrival[stop];
+                        board_key = key;
+                    }
+                }
+            }
+        }
+    }
+    scanned_count_ = scanned_count;
+}
+
+RaptorJourney RaptorRouter::ExtractJourney(const Search& search, uint32_t from, uint32_t to,
+                                           const Profile& profile) const {
+    RaptorJourney journey;
+    journey.total_time = search.arrival[to];
+    for (uint32_t stop = to; stop != from;) {
+        const Label& label = search.labels[stop];
+        const uint32_t board_stop = pattern_stops_[label.board_position];
+        journey.legs.push_back({
+            stops_[board_stop],
+            patterns_[label.pattern].bus,
+            static_cast<int>(label.alight_position - label.board_position),
+            (pattern_distances_[label.alight_position] - pattern_distances_[label.board_position])
+                / profile.speed_m_per_min
+        });
+        stop = board_stop;
+    }
+    std::reverse(journey.legs.begin(), journey.legs.end());
+    return journey;
+}
+
+std::optional<RaptorJourney> RaptorRouter::BuildJourney(const domain::Stop* from,
+                                                        const domain::Stop* to) const {
+    return BuildJourney(from, to, profile_);
+}
+
+std::optional<RaptorJourney> RaptorRouter::BuildJourney(
+    const domain::Stop* from, const domain::Stop* to,
+    const domain::RouteSettings& settings) const {
+    return BuildJourney(from, to, MakeProfile(settings));
+}
+
+std::optional<RaptorJourney> RaptorRouter::BuildJourney(const domain::Stop* from,
+                                                        const domain::Stop* to,
+                                                        const Profile& profile) const {
+    const uint32_t from_index = GetStopIndex(from);
+    const uint32_t to_index = GetStopIndex(to);
+    const auto search = AcquireSearch();
+    RunSearch(*search, from_index, to_index, profile);
+    if (search->arrival[to_index] == UNREACHED) {
+        return std::nullopt;
+    }
+    return ExtractJourney(*search, from_index, to_index, profile);
+}
+
+std::vector<std::optional<RaptorJourney>> RaptorRouter::BuildJourneys(
+    const domain::Stop* from, const std::vector<const domain::Stop*>& targets) const {
+    const uint32_t from_index = GetStopIndex(from);
+    const auto search = AcquireSearch();
+    RunSearch(*search, from_index, NO_INDEX, profile_);
+
+    std::vector<std::optional<RaptorJourney>> journeys;
+    journeys.reserve(targets.size());
+    for (const domain::Stop* target : targets) {
+        const uint32_t target_index = GetStopIndex(target);
+        if (search->arrival[target_index] == UNREACHED) {
+            journeys.push_back(std::nullopt);
+        } else {
+            journeys.push_back(ExtractJourney(*search, from_index, target_index, profile_));
+        }
+    }
+    return journeys;
+}
+
+} // namespace transport_catalogue
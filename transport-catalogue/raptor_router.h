@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "domain.h"
+#include "ride_patterns.h"
+#include "state_pool.h"
+#include "transport_catalogue.h"
+
+namespace transport_catalogue {
+
+// Участок маршрута: ожидание на остановке посадки и поездка на автобусе
+struct RaptorLeg {
+    const domain::Stop* board_stop = nullptr;
+    const domain::Bus* bus = nullptr;
+    int span_count = 0;
+    double ride_time = 0.0;
+};
+
+struct RaptorJourney {
+    double total_time = 0.0;
+    std::vector<RaptorLeg> legs;
+};
+
+// Поиск по раундам в духе RAPTOR прямо по последовательностям остановок
+// автобусов, без графа со рёбрами для каждой пары остановок. Раунд k находит
+// маршруты из k поездок: просматриваются только автобусы, проходящие через
+// остановки, улучшенные в прошлом раунде, начиная с самой ранней такой
+// остановки. Модель времени та же, что у графа TransportRouter: каждая посадка
+// стоит bus_wait_time, поездка — расстояние по дороге / скорость.
+// Запросы можно вызывать из нескольких потоков: каждый берёт свои рабочие
+// массивы из пула.
+class RaptorRouter {
+public:
+    RaptorRouter(const TransportCatalogue& catalogue, const domain::RouteSettings& settings);
+
+    std::optional<RaptorJourney> BuildJourney(const domain::Stop* from,
+                                              const domain::Stop* to) const;
+
+    // То же при других настройках: отрезки хранят расстояния, а не время,
+    // поэтому ничего не перестраивается
+    std::optional<RaptorJourney> BuildJourney(const domain::Stop* from, const domain::Stop* to,
+                                              const domain::RouteSettings& settings) const;
+
+    // Маршруты из from во все остановки targets одним поиском, в порядке targets
+    std::vector<std::optional<RaptorJourney>> BuildJourneys(
+        const domain::Stop* from, const std::vector<const domain::Stop*>& targets) const;
+
+    // Число просмотренных позиций маршрутов в последнем завершённом поиске
+    size_t GetScannedCount() const {
+        return scanned_count_;
+    }
+
+private:
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    // RidePattern в общих плоских массивах
+    struct Pattern {
+        const domain::Bus* bus = nullptr;
+        uint32_t begin = 0;  // позиции в pattern_stops_ и pattern_distances_
+        uint32_t end = 0;
+    };
+
+    // Последняя поездка на пути к остановке
+    struct Label {
+        uint32_t pattern = NO_INDEX;
+        uint32_t board_position = 0;
+        uint32_t alight_position = 0;
+    };
+
+    struct StopPosition {
+        uint32_t pattern;
+        uint32_t position;
+    };
+
+    // Настройки в единицах поиска
+    struct Profile {
+        double wait_time = 0.0;
+        double speed_m_per_min = 0.0;
+    };
+
+    // Рабочие массивы одного поиска
+    struct Search {
+        std::vector<double> arrival;
+        std::vector<Label> labels;
+        std::vector<uint32_t> marked_stops;
+        std::vector<char> is_marked;
+        std::vector<uint32_t> first_position;
+        std::vector<uint32_t> queued_patterns;
+    };
+
+    static Profile MakeProfile(const domain::RouteSettings& settings);
+
+    parallel::StatePool<Search>::Lease AcquireSearch() const {
+        return searches_.Acquire([] {
+            return Search{};
+        });
+    }
+
+    void AddPattern(const RidePattern& ride_pattern);
+    void BuildStopIndex();
+
+    std::optional<RaptorJourney> BuildJourney(const domain::Stop* from, const domain::Stop* to,
+                                              const Profile& profile) const;
+    void RunSearch(Search& search, uint32_t from, uint32_t target, const Profile& profile) const;
+    RaptorJourney ExtractJourney(const Search& search, uint32_t from, uint32_t to,
+                                 const Profile& profile) const;
+    uint32_t GetStopIndex(const domain::Stop* stop) const;
+
+    Profile profile_;
+
+    // Индекс — StopId
+    std::vector<const domain::Stop*> stops_;
+
+    std::vector<Pattern> patterns_;
+    std::vector<uint32_t> pattern_stops_;
+    // Расстояние по дороге от начала отрезка до позиции, в метрах
+    std::vector<double> pattern_distances_;
+
+    // Обратный индекс остановка -> (отрезок, позиция) в формате CSR
+    std::vector<uint32_t> stop_position_offsets_;
+    std::vector<StopPosition> stop_positions_;
+
+    parallel::StatePool<Search> searches_;
+    mutable std::atomic<size_t> scanned_count_ = 0;
+};
+
+} // namespace transport_catalogue
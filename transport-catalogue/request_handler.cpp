@@ -1,5 +1,6 @@
 #include "request_handler.h"
 #include "json_reader.h"
+#include <algorithm>
 
 namespace request_handler {
 
@@ -11,15 +12,19 @@ RequestHandler::RequestHandler(transport_catalogue::TransportCatalogue& catalogu
 }
 
 svg::Document RequestHandler::RenderMap() const {
-    std::map<std::string_view, const domain::Bus*> result;
+    std::vector<const domain::Bus*> result;
 
     const auto& busname_to_bus = catalogue_.GetBusnameToBus();
+    result.reserve(busname_to_bus.size());
 
     for (const auto& bus : busname_to_bus) {
         if (bus.second != nullptr) {
-            result.emplace(bus.first, bus.second);
+            result.push_back(bus.second);
         }
     }
+    std::sort(result.begin(), result.end(), [](const domain::Bus* lhs, const domain::Bus* rhs) {
+        return lhs->name < rhs->name;
+    });
 
     return render_.GetSVG(result);
 }
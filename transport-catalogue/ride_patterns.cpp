@@ -0,0 +1,60 @@
+#include "ride_patterns.h"
+
+namespace transport_catalogue {
+
+namespace {
+
+void AddDirection(const TransportCatalogue& catalogue, const domain::Bus* bus,
+                  const std::vector<const domain::Stop*>& stops,
+                  std::vector<RidePattern>& patterns) {
+    RidePattern run{bus, {stops.front()}, {}};
+    for (size_t i = 0; i + 1 < stops.size(); ++i) {
+        const int distance = catalogue.GetDistance(stops[i], stops[i + 1]);
+        if (distance > 0) {
+            run.stops.push_back(stops[i + 1]);
+            run.distances.push_back(distance);
+            continue;
+        }
+        if (run.stops.size() >= 2) {
+            patterns.push_back(run);
+        }
+        run.stops.assign(1, stops[i + 1]);
+        run.distances.clear();
+    }
+    if (run.stops.size() >= 2) {
+        patterns.push_back(std::move(run));
+    }
+}
+
+} // namespace
+
+std::vector<RidePattern> SplitIntoRidePatterns(const TransportCatalogue& catalogue,
+                                               const domain::Bus* bus) {
+    std::vector<RidePattern> patterns;
+    if (!bus || bus->stops.size() < 2) {
+        return patterns;
+    }
+
+    AddDirection(catalogue, bus, bus->stops, patterns);
+
+    if (!bus->is_roundtrip) {
+        AddDirection(catalogue, bus, {bus->stops.rbegin(), bus->stops.rend()}, patterns);
+        return patterns;
+    }
+
+    // Ребро замыкания кольца от последней остановки к первой есть, только если
+    // весь маршрут проезжаем; при совпадающих концах это петля, она не нужна
+    const auto* first_stop = bus->stops.front();
+    const auto* last_stop = bus->stops.back();
+    const bool is_whole_route = patterns.size() == 1
+                                && patterns.front().stops.size() == bus->stops.size();
+    if (first_stop == last_stop || !is_whole_route) {
+        return patterns;
+    }
+    if (const int distance = catalogue.GetDistance(last_stop, first_stop); distance > 0) {
+        patterns.push_back({bus, {last_stop, first_stop}, {distance}});
+    }
+    return patterns;
+}
+
+} // namespace transport_catalogue
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include "domain.h"
+#include "transport_catalogue.h"
+
+namespace transport_catalogue {
+
+// Отрезок маршрута автобуса в одном направлении, по которому можно ехать без
+// пересадки: distances[i] — расстояние по дороге от stops[i] до stops[i + 1]
+struct RidePattern {
+    const domain::Bus* bus = nullptr;
+    std::vector<const domain::Stop*> stops;
+    std::vector<int> distances;
+};
+
+// Отрезки, покрывающие те же поездки, что и рёбра графа TransportRouter:
+// прямое направление, обратное для некольцевого маршрута и замыкание кольца.
+// Перегон без расстояния разрывает маршрут: через него проехать нельзя
+std::vector<RidePattern> SplitIntoRidePatterns(const TransportCatalogue& catalogue,
+                                               const domain::Bus* bus);
+
+} // namespace transport_catalogue
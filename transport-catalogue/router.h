@@ -1,6 +1,9 @@
 #pragma once
 
+#include "dijkstra_all_pairs.h"
+#include "dynamic_all_pairs.h"
 #include "graph.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
@@ -15,19 +18,42 @@
 namespace graph {
 
 template <typename Weight>
-class Router {
-private:
-    using Graph = DirectedWeightedGraph<Weight>;
-
+class RouterBase {
 public:
-    explicit Router(const Graph& graph);
-
     struct RouteInfo {
         Weight weight;
         std::vector<EdgeId> edges;
     };
 
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    virtual ~RouterBase() = default;
+
+    virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+    // Число вершин, извлечённых из очереди последним запросом (0 для предрасчитанных таблиц)
+    virtual size_t GetSettledCount() const {
+        return 0;
+    }
+};
+
+template <typename Weight>
+class Router : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+
+    // DIJKSTRA и AUTO на разреженном графе считают строки параллельно
+    // на thread_count потоках (0 — по числу ядер), FLOYD_WARSHALL — в одном потоке
+    explicit Router(const Graph& graph, AllPairsMethod method = AllPairsMethod::AUTO,
+                    size_t thread_count = 0);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Обновляет таблицу после правки графа (граф уже разморожен, изменён
+    // и снова заморожен): пересчитываются только затронутые пары
+    void Update(const std::vector<EdgeId>& added_edges, const std::vector<EdgeId>& removed_edges,
+                size_t thread_count = 0);
 
 private:
     struct RouteInternalData {
@@ -36,18 +62,49 @@ private:
     };
     using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
 
+    // Адаптер таблицы для detail::AllPairsUpdater
+    class TableAccess {
+    public:
+        explicit TableAccess(RoutesInternalData& data)
+            : data_(data) {
+        }
+
+        size_t GetVertexCount() const {
+            return data_.size();
+        }
+        bool IsReachable(VertexId from, VertexId to) const {
+            return data_[from][to].has_value();
+        }
+        Weight GetWeight(VertexId from, VertexId to) const {
+            return data_[from][to]->weight;
+        }
+        EdgeId GetPrevEdge(VertexId from, VertexId to) const {
+            return data_[from][to]->prev_edge.value_or(detail::NO_TABLE_EDGE);
+        }
+        void Set(VertexId from, VertexId to, Weight weight, EdgeId prev_edge) {
+            data_[from][to] = RouteInternalData{
+                weight,
+                prev_edge == detail::NO_TABLE_EDGE ? std::nullopt : std::optional<EdgeId>(prev_edge)};
+        }
+        void Clear(VertexId from, VertexId to) {
+            data_[from][to].reset();
+        }
+
+    private:
+        RoutesInternalData& data_;
+    };
+
     void InitializeRoutesInternalData(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
             routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
-            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
+            for (const auto& arc : graph.GetOutgoingArcs(vertex)) {
+                if (arc.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                auto& route_internal_data = routes_internal_data_[vertex][arc.vertex];
+                if (!route_internal_data || route_internal_data->weight > arc.weight) {
+                    route_internal_data = RouteInternalData{arc.weight, arc.edge_id};
                 }
             }
         }
@@ -81,11 +138,21 @@ private:
 };
 
 template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+Router<Weight>::Router(const Graph& graph, AllPairsMethod method, size_t thread_count)
     : graph_(graph)
     , routes_internal_data_(graph.GetVertexCount(),
                             std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
 {
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building a router");
+    }
+    method = ChooseAllPairsMethod(method, graph.GetVertexCount(), graph.GetEdgeCount());
+    if (method == AllPairsMethod::DIJKSTRA) {
+        parallel::ThreadPool pool(thread_count);
+        TableAccess table(routes_internal_data_);
+        detail::DijkstraAllPairs<Weight, TableAccess>(graph, table, pool).Run();
+        return;
+    }
     InitializeRoutesInternalData(graph);
 
     const size_t vertex_count = graph.GetVertexCount();
@@ -94,6 +161,36 @@ Router<Weight>::Router(const Graph& graph)
     }
 }
 
+template <typename Weight>
+void Router<Weight>::Update(const std::vector<EdgeId>& added_edges,
+                            const std::vector<EdgeId>& removed_edges,
+                            size_t thread_count) {
+    if (!graph_.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before updating a router");
+    }
+    for (const EdgeId edge_id : added_edges) {
+        if (graph_.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    // Новые вершины: пока без путей, кроме пути в себя
+    const size_t old_vertex_count = routes_internal_data_.size();
+    const size_t vertex_count = graph_.GetVertexCount();
+    routes_internal_data_.resize(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        routes_internal_data_[vertex].resize(vertex_count);
+        if (vertex >= old_vertex_count) {
+            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+        }
+    }
+
+    parallel::ThreadPool pool(thread_count);
+    TableAccess table(routes_internal_data_);
+    detail::AllPairsUpdater<Weight, TableAccess>(graph_, table, pool)
+        .Update(added_edges, removed_edges);
+}
+
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
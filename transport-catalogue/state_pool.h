@@ -0,0 +1,86 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace parallel {
+
+// Рабочие состояния для одновременных запросов к одному объекту. Запрос берёт
+// свободное состояние или создаёт новое и возвращает его в пул, когда Lease
+// уничтожается. Состояний не больше, чем запросов, шедших одновременно, и
+// в однопоточной работе массивы по-прежнему выделяются один раз.
+template <typename State>
+class StatePool {
+public:
+    class Lease {
+    public:
+        Lease(const StatePool& pool, std::unique_ptr<State> state)
+            : pool_(&pool)
+            , state_(std::move(state)) {
+        }
+
+        Lease(Lease&&) noexcept = default;
+        Lease& operator=(Lease&&) = delete;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        ~Lease() {
+            if (state_) {
+                pool_->Release(std::move(state_));
+            }
+        }
+
+        State& operator*() const {
+            return *state_;
+        }
+
+        State* operator->() const {
+            return state_.get();
+        }
+
+    private:
+        const StatePool* pool_;
+        std::unique_ptr<State> state_;
+    };
+
+    StatePool() = default;
+    StatePool(const StatePool&) = delete;
+    StatePool& operator=(const StatePool&) = delete;
+
+    // make_state() создаёт состояние, если свободных нет
+    template <typename MakeState>
+    Lease Acquire(MakeState make_state) const {
+        std::unique_ptr<State> state;
+        {
+            std::lock_guard guard(mutex_);
+            if (!free_.empty()) {
+                state = std::move(free_.back());
+                free_.pop_back();
+            }
+        }
+        if (!state) {
+            state = std::make_unique<State>(make_state());
+        }
+        return Lease(*this, std::move(state));
+    }
+
+    // Освобождает свободные состояния, например после изменения размеров графа.
+    // Вызывается, когда запросов нет
+    void Clear() {
+        std::lock_guard guard(mutex_);
+        free_.clear();
+    }
+
+private:
+    void Release(std::unique_ptr<State> state) const {
+        std::lock_guard guard(mutex_);
+        free_.push_back(std::move(state));
+    }
+
+    mutable std::mutex mutex_;
+    mutable std::vector<std::unique_ptr<State>> free_;
+};
+
+}  // namespace parallel
@@ -0,0 +1,333 @@
+// Проверки маршрутизатора. Сборка и запуск из каталога transport-catalogue:
+//   g++ -std=c++20 -O2 -pthread -I. -o transport_router_test tests/transport_router_test.cpp
+//       $(ls *.cpp | grep -v main.cpp) && ./transport_router_test
+#include "transport_router.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <variant>
+#include <vector>
+
+using namespace transport_catalogue;
+
+namespace {
+
+const std::vector<RouterType> ALL_ROUTER_TYPES = {
+    RouterType::ALL_PAIRS, RouterType::COMPACT_ALL_PAIRS, RouterType::DIJKSTRA,
+    RouterType::BIDIRECTIONAL, RouterType::ASTAR, RouterType::CONTRACTION_HIERARCHY,
+    RouterType::ALT, RouterType::HUB_LABELS, RouterType::OVERLAY, RouterType::RAPTOR
+};
+
+const std::vector<GraphModel> ALL_GRAPH_MODELS = {GraphModel::SPAN_EDGES, GraphModel::LINEAR_RIDES};
+
+// Таблица COMPACT_ALL_PAIRS хранит веса во float
+bool IsSameTime(Minutes lhs, Minutes rhs) {
+    return std::abs(lhs.count() - rhs.count()) < 1e-4 * std::max(1.0, lhs.count());
+}
+
+bool IsSameAnswer(const std::optional<RouteData>& lhs, const std::optional<RouteData>& rhs) {
+    return lhs.has_value() == rhs.has_value()
+           && (!lhs || IsSameTime(lhs->total_time, rhs->total_time));
+}
+
+// Элементы маршрута складываются в его время, и каждая поездка начинается
+// ожиданием на остановке, через которую идёт автобус
+void CheckItems(const TransportCatalogue& catalogue, const RouteData& route) {
+    double total = 0.0;
+    std::string wait_stop;
+    for (const auto& item : route.items) {
+        if (const auto* wait = std::get_if<domain::WaitItem>(&item)) {
+            wait_stop = wait->stop_name;
+            total += wait->time;
+            continue;
+        }
+        const auto& ride = std::get<domain::BusItem>(item);
+        const domain::Bus* bus = catalogue.GetBus(ride.bus);
+        assert(bus && ride.span_count > 0);
+        assert(std::any_of(bus->stops.begin(), bus->stops.end(), [&](const domain::Stop* stop) {
+            return stop->name == wait_stop;
+        }));
+        total += ride.time;
+    }
+    assert(IsSameTime(Minutes(total), route.total_time));
+}
+
+std::vector<std::string> GetStopNames(const TransportCatalogue& catalogue) {
+    std::vector<std::string> names;
+    for (domain::StopId id = 0; id < catalogue.GetStopCount(); ++id) {
+        names.push_back(catalogue.GetStopById(id)->name);
+    }
+    return names;
+}
+
+// Случайная сеть: некольцевые автобусы и кольцевые, с повтором первой остановки
+// и с перегоном замыкания, часть расстояний задана только в одну сторону,
+// остановка без автобусов и отдельный остров
+void FillNetwork(TransportCatalogue& catalogue, uint32_t seed) {
+    std::mt19937 random(seed);
+    const int stop_count = 30;
+    for (int i = 0; i < stop_count; ++i) {
+        catalogue.AddStop("S" + std::to_string(i),
+                          {55.55 + 0.002 * (random() % 100), 37.50 + 0.002 * (random() % 100)});
+    }
+    catalogue.AddStop("Island A", {55.40, 37.40});
+    catalogue.AddStop("Island B", {55.41, 37.40});
+    catalogue.AddStop("Lonely", {55.45, 37.45});
+
+    const auto set_distance = [&catalogue, &random](const std::string& from, const std::string& to) {
+        const domain::Stop* from_stop = catalogue.GetStop(from);
+        const domain::Stop* to_stop = catalogue.GetStop(to);
+        catalogue.SetDistance(from_stop, to_stop, 300 + random() % 3000);
+        if (random() % 2 == 0) {
+            catalogue.SetDistance(to_stop, from_stop, 300 + random() % 3000);
+        }
+    };
+    for (int bus = 0; bus < 10; ++bus) {
+        const bool is_roundtrip = bus % 3 == 0;
+        std::vector<std::string> stops;
+        for (size_t i = 0, size = 3 + random() % 6; i < size; ++i) {
+            stops.push_back("S" + std::to_string(random() % stop_count));
+        }
+        for (size_t i = 0; i + 1 < stops.size(); ++i) {
+            set_distance(stops[i], stops[i + 1]);
+        }
+        if (is_roundtrip && bus % 2 == 0) {
+            set_distance(stops.back(), stops.front());
+            stops.push_back(stops.front());
+        } else if (is_roundtrip) {
+            set_distance(stops.back(), stops.front());
+        }
+        catalogue.AddBus(std::to_string(bus), stops, is_roundtrip);
+    }
+    set_distance("Island A", "Island B");
+    catalogue.AddBus("Island", {"Island A", "Island B"}, false);
+}
+
+// Все движки и обе модели графа отвечают так же, как таблица всех пар
+void TestEnginesMatchAllPairs() {
+    const domain::RouteSettings settings{4, 30.0};
+    for (uint32_t seed = 1; seed <= 3; ++seed) {
+        TransportCatalogue catalogue;
+        FillNetwork(catalogue, seed);
+        const std::vector<std::string> names = GetStopNames(catalogue);
+
+        RouterOptions reference_options;
+        reference_options.type = RouterType::ALL_PAIRS;
+        const TransportRouter reference(catalogue, settings, reference_options);
+        for (const RouterType type : ALL_ROUTER_TYPES) {
+            for (const GraphModel model : ALL_GRAPH_MODELS) {
+                RouterOptions options;
+                options.type = type;
+                options.graph_model = model;
+                options.landmark_count = 4;
+                options.overlay_cell_size = 8;
+                const TransportRouter router(catalogue, settings, options);
+                for (const std::string& from : names) {
+                    for (const std::string& to : names) {
+                        const auto expected = reference.BuildRoute(from, to);
+                        const auto route = router.BuildRoute(from, to);
+                        assert(IsSameAnswer(route, expected));
+                        if (route) {
+                            CheckItems(catalogue, *route);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Матрица маршрутов и достижимые остановки совпадают с ответами BuildRoute
+void TestBatchQueriesMatchSingleRoutes() {
+    const domain::RouteSettings settings{2, 40.0};
+    TransportCatalogue catalogue;
+    FillNetwork(catalogue, 7);
+    const std::vector<std::string> names = GetStopNames(catalogue);
+    std::vector<std::string_view> stops(names.begin(), names.end());
+    stops.push_back("Unknown");
+
+    for (const RouterType type : ALL_ROUTER_TYPES) {
+        RouterOptions options;
+        options.type = type;
+        options.landmark_count = 4;
+        const TransportRouter router(catalogue, settings, options);
+        for (const bool with_items : {false, true}) {
+            const RouteMatrix matrix = router.BuildRoutes(stops, stops, with_items);
+            assert(matrix.size() == stops.size());
+            for (size_t row = 0; row < stops.size(); ++row) {
+                assert(matrix[row].size() == stops.size());
+                for (size_t column = 0; column < stops.size(); ++column) {
+                    const auto& route = matrix[row][column];
+                    assert(IsSameAnswer(route, router.BuildRoute(stops[row], stops[column])));
+                    if (route && with_items) {
+                        CheckItems(catalogue, *route);
+                    } else if (route) {
+                        assert(route->items.empty());
+                    }
+                }
+            }
+        }
+
+        for (const Minutes max_time : {Minutes(0), Minutes(15), Minutes(1000)}) {
+            for (const std::string& from : names) {
+                const auto reachable = router.FindReachable(from, max_time);
+                std::vector<std::string> expected;
+                for (const std::string& to : names) {
+                    const auto route = router.BuildRoute(from, to);
+                    if (route && route->total_time <= max_time) {
+                        expected.push_back(to);
+                    }
+                }
+                assert(reachable.size() == expected.size());
+                for (size_t i = 0; i < reachable.size(); ++i) {
+                    assert(i == 0 || !(reachable[i].time < reachable[i - 1].time));
+                    const auto route = router.BuildRoute(from, reachable[i].stop->name);
+                    assert(route && IsSameTime(route->total_time, reachable[i].time));
+                }
+            }
+        }
+    }
+}
+
+void CorruptFile(const std::string& path) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(0, std::ios::end);
+    const std::streamoff size = file.tellg();
+    assert(size > 0);
+    file.seekg(size / 2);
+    const char byte = static_cast<char>(file.get());
+    file.seekp(size / 2);
+    file.put(static_cast<char>(byte ^ 0x5a));
+}
+
+void TruncateFile(const std::string& path) {
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) / 3);
+}
+
+// Кэш загружается только для того же справочника и целого файла; испорченный
+// файл строится заново, и ответы не меняются. Граф из файла подходит и для
+// других настроек: веса рёбер считаются по расстояниям
+void TestCacheRoundTrip() {
+    const domain::RouteSettings settings{3, 35.0};
+    TransportCatalogue catalogue;
+    FillNetwork(catalogue, 11);
+    const std::vector<std::string> names = GetStopNames(catalogue);
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "transport_router_test.cache").string();
+
+    RouterOptions reference_options;
+    reference_options.type = RouterType::ALL_PAIRS;
+    const TransportRouter reference(catalogue, settings, reference_options);
+    const auto check_answers = [&](const TransportRouter& router) {
+        for (const std::string& from : names) {
+            for (const std::string& to : names) {
+                assert(IsSameAnswer(router.BuildRoute(from, to), reference.BuildRoute(from, to)));
+            }
+        }
+    };
+
+    for (const RouterType type : {RouterType::COMPACT_ALL_PAIRS, RouterType::HUB_LABELS,
+                                  RouterType::DIJKSTRA}) {
+        for (const GraphModel model : ALL_GRAPH_MODELS) {
+            std::remove(path.c_str());
+            RouterOptions options;
+            options.type = type;
+            options.graph_model = model;
+            options.cache_path = path;
+            {
+                const TransportRouter built(catalogue, settings, options);
+                assert(!built.IsLoadedFromCache());
+                check_answers(built);
+            }
+            {
+                const TransportRouter loaded(catalogue, settings, options);
+                assert(loaded.IsLoadedFromCache());
+                check_answers(loaded);
+            }
+            for (const auto damage : {CorruptFile, TruncateFile}) {
+                damage(path);
+                const TransportRouter rebuilt(catalogue, settings, options);
+                assert(!rebuilt.IsLoadedFromCache());
+                check_answers(rebuilt);
+                // Испорченный файл перезаписан
+                const TransportRouter reloaded(catalogue, settings, options);
+                assert(reloaded.IsLoadedFromCache());
+                check_answers(reloaded);
+            }
+
+            const domain::RouteSettings other_settings{settings.bus_wait_time + 1,
+                                                       settings.bus_velocity * 2};
+            const TransportRouter other(catalogue, other_settings, options);
+            const TransportRouter other_reference(catalogue, other_settings, reference_options);
+            for (const std::string& from : names) {
+                for (const std::string& to : names) {
+                    assert(IsSameAnswer(other.BuildRoute(from, to),
+                                        other_reference.BuildRoute(from, to)));
+                }
+            }
+
+            TransportCatalogue changed_catalogue;
+            FillNetwork(changed_catalogue, 11);
+            changed_catalogue.AddBus("Extra", {"S0", "S1"}, false);
+            const TransportRouter changed(changed_catalogue, settings, options);
+            assert(!changed.IsLoadedFromCache());
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// Расстояние B -> A задаётся после построения маршрутизатора: раньше GetDistance
+// подставлял для него A -> B, и UpdateBus другого автобуса оставлял старый вес
+void TestUpdateBusAppliesChangedDistances() {
+    const domain::RouteSettings settings{1, 60.0};
+    for (const RouterType type : ALL_ROUTER_TYPES) {
+        for (const GraphModel model : ALL_GRAPH_MODELS) {
+            TransportCatalogue catalogue;
+            catalogue.AddStop("A", {55.60, 37.20});
+            catalogue.AddStop("B", {55.61, 37.20});
+            catalogue.SetDistance(catalogue.GetStop("A"), catalogue.GetStop("B"), 1000);
+            catalogue.AddBus("1", {"A", "B"}, false);
+
+            RouterOptions options;
+            options.type = type;
+            options.graph_model = model;
+            TransportRouter router(catalogue, settings, options);
+            assert(IsSameTime(router.BuildRoute("B", "A")->total_time, Minutes(2)));
+
+            catalogue.AddStop("C", {55.60, 37.21});
+            catalogue.SetDistance(catalogue.GetStop("B"), catalogue.GetStop("A"), 5000);
+            catalogue.SetDistance(catalogue.GetStop("A"), catalogue.GetStop("C"), 500);
+            catalogue.AddBus("2", {"A", "C"}, false);
+            router.UpdateBus("2");
+
+            const TransportRouter fresh(catalogue, settings, options);
+            for (const std::string_view from : {"A", "B", "C"}) {
+                for (const std::string_view to : {"A", "B", "C"}) {
+                    const auto updated_route = router.BuildRoute(from, to);
+                    const auto fresh_route = fresh.BuildRoute(from, to);
+                    assert(updated_route.has_value() == fresh_route.has_value());
+                    if (updated_route) {
+                        assert(IsSameTime(updated_route->total_time, fresh_route->total_time));
+                    }
+                }
+            }
+            assert(IsSameTime(router.BuildRoute("B", "A")->total_time, Minutes(6)));
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    TestEnginesMatchAllPairs();
+    TestBatchQueriesMatchSingleRoutes();
+    TestCacheRoundTrip();
+    TestUpdateBusAppliesChangedDistances();
+    std::cout << "transport_router_test: OK" << std::endl;
+}
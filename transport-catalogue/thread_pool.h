@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace parallel {
+
+// Постоянный пул потоков для параллельных циклов. ParallelFor раздаёт индексы
+// задач через атомарный счётчик, вызывающий поток тоже участвует в работе
+// и возвращается, когда выполнены все задачи. Номер исполнителя worker
+// лежит в [0, GetThreadCount()) и позволяет задачам держать свои буферы.
+// Исключение задачи (первое, если их несколько) останавливает раздачу
+// оставшихся индексов и пробрасывается из ParallelFor после того, как все
+// потоки закончили свои задачи.
+class ThreadPool {
+public:
+    using Task = std::function<void(size_t index, size_t worker)>;
+
+    // thread_count == 0 — по числу аппаратных потоков
+    explicit ThreadPool(size_t thread_count = 0) {
+        if (thread_count == 0) {
+            thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        workers_.reserve(thread_count - 1);
+        for (size_t worker = 1; worker < thread_count; ++worker) {
+            workers_.emplace_back([this, worker] { WorkerLoop(worker); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        job_started_.notify_all();
+        for (auto& thread : workers_) {
+            thread.join();
+        }
+    }
+
+    size_t GetThreadCount() const {
+        return workers_.size() + 1;
+    }
+
+    void ParallelFor(size_t task_count, const Task& task) {
+        if (task_count == 0) {
+            return;
+        }
+        if (workers_.empty() || task_count == 1) {
+            for (size_t index = 0; index < task_count; ++index) {
+                task(index, 0);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard lock(mutex_);
+            task_ = &task;
+            task_count_ = task_count;
+            next_index_ = 0;
+            busy_workers_ = workers_.size();
+            error_ = nullptr;
+            ++job_generation_;
+        }
+        job_started_.notify_all();
+
+        RunTasks(0);
+
+        // Потоки обращаются к task, пока не закончат, поэтому ожидание
+        // не пропускается и при исключении
+        std::unique_lock lock(mutex_);
+        job_finished_.wait(lock, [this] { return busy_workers_ == 0; });
+        task_ = nullptr;
+        if (error_) {
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+    }
+
+private:
+    void RunTasks(size_t worker) {
+        try {
+            for (size_t index = next_index_++; index < task_count_; index = next_index_++) {
+                (*task_)(index, worker);
+            }
+        } catch (...) {
+            std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            next_index_ = task_count_;
+        }
+    }
+
+    void WorkerLoop(size_t worker) {
+        uint64_t seen_generation = 0;
+        for (;;) {
+            {
+                std::unique_lock lock(mutex_);
+                job_started_.wait(lock, [&] {
+                    return stopping_ || job_generation_ != seen_generation;
+                });
+                if (stopping_) {
+                    return;
+                }
+                seen_generation = job_generation_;
+            }
+
+            RunTasks(worker);
+
+            {
+                std::lock_guard lock(mutex_);
+                --busy_workers_;
+            }
+            job_finished_.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable job_started_;
+    std::condition_variable job_finished_;
+    const Task* task_ = nullptr;
+    size_t task_count_ = 0;
+    std::atomic<size_t> next_index_ = 0;
+    size_t busy_workers_ = 0;
+    std::exception_ptr error_;
+    uint64_t job_generation_ = 0;
+    bool stopping_ = false;
+};
+
+}  // namespace parallel
@@ -1,5 +1,5 @@
+#include <algorithm>
 #include <unordered_map>
-#include <unordered_set>
 #include <optional>
 #include <cmath>
 #include "geo.h"
@@ -8,12 +8,16 @@
 namespace transport_catalogue {
 
 void TransportCatalogue::AddStop(const std::string& name, geo::Coordinates coordinates) {
-    all_stops_.push_back({name, coordinates});
+    ++version_;
+    const auto id = static_cast<domain::StopId>(all_stops_.size());
+    all_stops_.push_back({name, coordinates, id});
     stopname_to_stop_[all_stops_.back().name] = &all_stops_.back();
-    stop_to_buses_[all_stops_.back().name];
+    stop_to_buses_.emplace_back();
+    distances_.emplace_back();
 }
 
 void TransportCatalogue::AddBus(const std::string& name_number, const std::vector<std::string>& stops, bool is_roundtrip) {
+    ++version_;
     std::vector<const domain::Stop*> bus_stops;
     bus_stops.reserve(stops.size());
 
@@ -23,23 +27,23 @@ void TransportCatalogue::AddBus(const std::string& name_number, const std::vecto
         }
     }
 
-    all_buses_.push_back({name_number, std::move(bus_stops), is_roundtrip});
-    busname_to_bus_[all_buses_.back().name] = &all_buses_.back();
-    UpdateStopToBus(name_number, stops);
-}
-
-void TransportCatalogue::UpdateStopToBus(const std::string& name_number, const std::vector<std::string>& stops) {
-    auto it = busname_to_bus_.find(name_number);
-    if (it == busname_to_bus_.end()) {
-        return;
+    // Повторное добавление заменяет автобус; прежняя версия остаётся в all_buses_,
+    // чтобы указатели на неё, выданные раньше, не повисли
+    if (auto it = busname_to_bus_.find(name_number); it != busname_to_bus_.end()) {
+        for (const domain::Stop* stop : it->second->stops) {
+            stop_to_buses_[stop->id].erase(it->second);
+        }
     }
 
-    const domain::Bus* bus_ptr = it->second;
+    const auto id = static_cast<domain::BusId>(all_buses_.size());
+    all_buses_.push_back({name_number, std::move(bus_stops), is_roundtrip, id});
+    busname_to_bus_[all_buses_.back().name] = &all_buses_.back();
+    UpdateStopToBus(&all_buses_.back());
+}
 
-    for (const auto& stop_name : stops) {
-        if (auto it = stopname_to_stop_.find(stop_name); it != stopname_to_stop_.end()) {
-            stop_to_buses_[stop_name].insert(bus_ptr);
-        }
+void TransportCatalogue::UpdateStopToBus(const domain::Bus* bus) {
+    for (const domain::Stop* stop : bus->stops) {
+        stop_to_buses_[stop->id].insert(bus);
     }
 }
 
@@ -59,11 +63,25 @@ const domain::Stop* TransportCatalogue::GetStop(std::string_view name) const {
     return nullptr;
 }
 
-std::set<const domain::Bus*, detail::BusPtrCompare> TransportCatalogue::GetBusesForStop(std::string_view stop_name) const {
-    if (auto it = stop_to_buses_.find(stop_name); it != stop_to_buses_.end()) {
-        return it->second;
-    }
-    return {};
+const std::set<const domain::Bus*, detail::BusPtrCompare>& TransportCatalogue::GetBusesForStop(
+    domain::StopId stop_id) const {
+    return stop_to_buses_.at(stop_id);
+}
+
+const domain::Stop* TransportCatalogue::GetStopById(domain::StopId stop_id) const {
+    return &all_stops_.at(stop_id);
+}
+
+const domain::Bus* TransportCatalogue::GetBusById(domain::BusId bus_id) const {
+    return &all_buses_.at(bus_id);
+}
+
+size_t TransportCatalogue::GetStopCount() const {
+    return all_stops_.size();
+}
+
+size_t TransportCatalogue::GetBusCount() const {
+    return all_buses_.size();
 }
 
 std::optional<domain::RouteInfo> TransportCatalogue::GetRouteInfo(std::string_view number_name) const {
@@ -74,8 +92,14 @@ std::optional<domain::RouteInfo> TransportCatalogue::GetRouteInfo(std::string_vi
         return std::nullopt;
     }
 
-    std::unordered_set<const domain::Stop*> unique_stops(bus->stops.begin(), bus->stops.end());
-    info.unique_stops_count = static_cast<int>(unique_stops.size());
+    std::vector<domain::StopId> unique_stops;
+    unique_stops.reserve(bus->stops.size());
+    for (const domain::Stop* stop : bus->stops) {
+        unique_stops.push_back(stop->id);
+    }
+    std::sort(unique_stops.begin(), unique_stops.end());
+    info.unique_stops_count = static_cast<int>(
+        std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin());
 
     if (bus->is_roundtrip) {
         info.stops_count = static_cast<int>(bus->stops.size());
@@ -123,22 +147,44 @@ std::optional<domain::RouteInfo> TransportCatalogue::GetRouteInfo(std::string_vi
 }
 
 void TransportCatalogue::SetDistance(const domain::Stop* from, const domain::Stop* to, int meters) {
-    std::pair<const domain::Stop*, const domain::Stop*> var = {from, to};
-    distances_[var] = meters;
+    ++version_;
+    auto& neighbours = distances_[from->id];
+    const auto it = std::find_if(neighbours.begin(), neighbours.end(),
+                                 [to](const auto& neighbour) { return neighbour.first == to->id; });
+    if (it == neighbours.end()) {
+        neighbours.emplace_back(to->id, meters);
+    } else if (it->second != meters) {
+        it->second = meters;
+    } else {
+        return;
+    }
+    distance_changes_.push_back({version_, from->id, to->id});
 }
 
-int TransportCatalogue::GetDistance(const domain::Stop* from_stop, const domain::Stop* to_stop) const {
-    auto key_pair_from_to = std::make_pair(from_stop, to_stop);
-    auto key_pair_to_from = std::make_pair(to_stop, from_stop);
+std::vector<std::pair<const domain::Stop*, const domain::Stop*>> TransportCatalogue::GetDistanceChanges(
+    uint64_t version) const {
+    const auto first = std::upper_bound(
+        distance_changes_.begin(), distance_changes_.end(), version,
+        [](uint64_t value, const DistanceChange& change) { return value < change.version; });
+    std::vector<std::pair<const domain::Stop*, const domain::Stop*>> changes;
+    changes.reserve(distance_changes_.end() - first);
+    for (auto it = first; it != distance_changes_.end(); ++it) {
+        changes.emplace_back(&all_stops_[it->from], &all_stops_[it->to]);
+    }
+    return changes;
+}
 
-    auto itf = distances_.find(key_pair_from_to);
-    if (itf != distances_.end()) {
-        return itf->second;
+int TransportCatalogue::GetDistance(const domain::Stop* from_stop, const domain::Stop* to_stop) const {
+    for (const auto& [stop_id, distance] : distances_[from_stop->id]) {
+        if (stop_id == to_stop->id) {
+            return distance;
+        }
     }
 
-    auto itt = distances_.find(key_pair_to_from);
-    if (itt != distances_.end()) {
-        return itt->second;
+    for (const auto& [stop_id, distance] : distances_[to_stop->id]) {
+        if (stop_id == from_stop->id) {
+            return distance;
+        }
     }
 
     return 0;
@@ -8,20 +8,13 @@
 #include <deque>  
 #include <set>  
 #include <memory> 
+#include <cstdint>
 #include "geo.h"  
 #include "domain.h"  
 
 namespace transport_catalogue { 
 
 namespace detail {  
-    struct PairHasher {  
-        size_t operator()(const std::pair<const domain::Stop*, const domain::Stop*> pr) const {  
-            auto h1 = std::hash<const domain::Stop*>{}(pr.first);  
-            auto h2 = std::hash<const domain::Stop*>{}(pr.second);  
-            return h1 + h2 * 37;  
-        }  
-    };  
-
     struct BusPtrCompare {  
         bool operator()(const domain::Bus* lhs, const domain::Bus* rhs) const {  
             return lhs->name < rhs->name;  
@@ -37,12 +30,23 @@ public:
     const domain::Bus* GetBus(std::string_view name) const;  
     const domain::Stop* GetStop(std::string_view name) const;  
 
-    std::set<const domain::Bus*, detail::BusPtrCompare> GetBusesForStop(std::string_view stop_name) const;  
+    // Номера выдаются подряд с нуля; заменённые версии автобусов сохраняют свои номера
+    const domain::Stop* GetStopById(domain::StopId stop_id) const;
+    const domain::Bus* GetBusById(domain::BusId bus_id) const;
+    size_t GetStopCount() const;
+    size_t GetBusCount() const;
+
+    const std::set<const domain::Bus*, detail::BusPtrCompare>& GetBusesForStop(domain::StopId stop_id) const;  
     std::optional<domain::RouteInfo> GetRouteInfo(std::string_view name) const;  
 
     void AddDistance(const std::string& name, const std::vector<std::pair<int, std::string>>& pvc);  
     void SetDistance(const domain::Stop* from, const domain::Stop* to, int meters);  
     int GetDistance(const domain::Stop* from, const domain::Stop* to) const;  
+    // Пары остановок (from, to) из вызовов SetDistance, изменивших расстояние после
+    // версии version, в порядке изменения. Из-за подстановки обратного расстояния
+    // в GetDistance меняться могло расстояние в обе стороны
+    std::vector<std::pair<const domain::Stop*, const domain::Stop*>> GetDistanceChanges(
+        uint64_t version) const;
 
     const std::unordered_map<std::string_view, const domain::Bus*>& GetBusnameToBus() const {  
         return busname_to_bus_;  
@@ -52,16 +56,32 @@ public:
         return stopname_to_stop_; 
     } 
 
+    // Номер версии данных: растёт при каждом изменении остановок, маршрутов
+    // или расстояний. Позволяет кэшам замечать устаревшие ответы
+    uint64_t GetVersion() const {
+        return version_;
+    }
+
 private:  
-    void UpdateStopToBus(const std::string& name_number, const std::vector<std::string>& stops);  
+    void UpdateStopToBus(const domain::Bus* bus);  
 
     std::deque<domain::Bus> all_buses_;  
     std::deque<domain::Stop> all_stops_;  
 
     std::unordered_map<std::string_view, const domain::Stop*> stopname_to_stop_;  
     std::unordered_map<std::string_view, const domain::Bus*> busname_to_bus_;  
-    std::unordered_map<std::string_view, std::set<const domain::Bus*, detail::BusPtrCompare>> stop_to_buses_;  
-    std::unordered_map<std::pair<const domain::Stop*, const domain::Stop*>, int, detail::PairHasher> distances_; 
+    // Индексы — StopId
+    std::vector<std::set<const domain::Bus*, detail::BusPtrCompare>> stop_to_buses_;  
+    // Заданные расстояния от остановки до соседних: соседей мало, поиск линейный
+    std::vector<std::vector<std::pair<domain::StopId, int>>> distances_; 
+    // Журнал SetDistance по возрастанию версии, для GetDistanceChanges
+    struct DistanceChange {
+        uint64_t version;
+        domain::StopId from;
+        domain::StopId to;
+    };
+    std::vector<DistanceChange> distance_changes_;
+    uint64_t version_ = 0;
 };  
 
 } // namespace transport_catalogue
\ No newline at end of file
@@ -1,219 +1,1449 @@
 #include "transport_router.h"
+#include "geo.h"
+#include "thread_pool.h"
 #include <cmath>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
 
 namespace transport_catalogue {
 
 TransportRouter::TransportRouter(const TransportCatalogue& catalogue, 
-                               const domain::RouteSettings& settings)
+                               const domain::RouteSettings& settings,
+                               const RouterOptions& options)
     : catalogue_(catalogue)
-    , settings_(settings) {
-    BuildGraph();
+    , settings_(settings)
+    , options_(options)
+    , synced_version_(catalogue.GetVersion()) {
+    if (options_.type == RouterType::RAPTOR) {
+        // Предрасчёта нет, кэшировать нечего
+        raptor_ = std::make_unique<RaptorRouter>(catalogue_, settings_);
+    } else if (options_.cache_path.empty() || !LoadCache()) {
+        BuildGraph();
+        if (!options_.cache_path.empty()) {
+            // Не записанный кэш не мешает работе: он будет построен при следующем запуске
+            SaveCache();
+        }
+    }
+
+    if (options_.answer_cache_size > 0) {
+        answer_cache_ = std::make_unique<cache::ClockCache<AnswerKey, SharedRoute>>(
+            options_.answer_cache_size);
+        for (const auto& [from, to] : options_.answer_cache_warm_up) {
+            BuildRoute(from, to);
+        }
+    }
+}
+
+void TransportRouter::CreateRouter() {
+    // Все маршрутизаторы работают с CSR-представлением графа
+    graph_->Freeze();
+    batch_router_ = std::make_unique<graph::DijkstraRouter<double>>(*graph_);
+    tree_cache_ = nullptr;
+    all_pairs_router_ = nullptr;
+    compact_router_ = nullptr;
+    component_all_pairs_router_ = nullptr;
+    component_compact_router_ = nullptr;
+    hub_label_router_ = nullptr;
+    overlay_router_ = nullptr;
+    overlay_metric_.reset();
+    components_ = graph::GraphComponents(*graph_);
+    // Таблицы всех пар при нескольких компонентах занимают сумму квадратов
+    // размеров компонент вместо V^2
+    const bool split_tables = components_.GetComponentCount() > 1;
+    switch (options_.type) {
+    case RouterType::ALL_PAIRS:
+        if (split_tables) {
+            auto split = std::make_unique<AllPairsComponents>(*graph_, components_,
+                                                              MakeAllPairsFactory());
+            component_all_pairs_router_ = split.get();
+            router_ = std::move(split);
+        } else {
+            auto all_pairs = MakeAllPairsFactory()(0, *graph_);
+            all_pairs_router_ = all_pairs.get();
+            router_ = std::move(all_pairs);
+        }
+        break;
+    case RouterType::COMPACT_ALL_PAIRS:
+        if (split_tables) {
+            auto split = std::make_unique<CompactComponents>(*graph_, components_,
+                                                             MakeCompactFactory(TakeCachedTables()));
+            component_compact_router_ = split.get();
+            router_ = std::move(split);
+        } else {
+            auto compact = MakeCompactFactory(TakeCachedTables())(0, *graph_);
+            compact_router_ = compact.get();
+            router_ = std::move(compact);
+        }
+        break;
+    case RouterType::DIJKSTRA:
+        if (options_.tree_cache_bytes > 0) {
+            auto cache = std::make_unique<graph::TreeCacheRouter<double>>(
+                *graph_, options_.tree_cache_bytes);
+            tree_cache_ = cache.get();
+            router_ = std::move(cache);
+        } else {
+            router_ = std::make_unique<graph::DijkstraRouter<double>>(*graph_);
+        }
+        break;
+    case RouterType::BIDIRECTIONAL:
+        router_ = std::make_unique<graph::BidirectionalRouter<double>>(*graph_);
+        break;
+    case RouterType::ASTAR:
+        PrepareHeuristic();
+        router_ = std::make_unique<graph::AStarRouter<double>>(
+            *graph_, [this](graph::VertexId vertex, graph::VertexId target) {
+                return EstimateTime(vertex, target);
+            });
+        break;
+    case RouterType::CONTRACTION_HIERARCHY:
+        router_ = std::make_unique<graph::ContractionHierarchyRouter<double>>(*graph_);
+        break;
+    case RouterType::ALT:
+        router_ = std::make_unique<graph::AltRouter<double>>(*graph_, options_.landmark_count,
+                                                             options_.landmark_selection);
+        break;
+    case RouterType::HUB_LABELS: {
+        std::unique_ptr<graph::HubLabelRouter<double>> hub_labels;
+        if (cached_labels_) {
+            hub_labels = std::make_unique<graph::HubLabelRouter<double>>(*graph_,
+                                                                         std::move(*cached_labels_));
+            cached_labels_.reset();
+        } else {
+            hub_labels = std::make_unique<graph::HubLabelRouter<double>>(*graph_);
+        }
+        hub_label_router_ = hub_labels.get();
+        router_ = std::move(hub_labels);
+        break;
+    }
+    case RouterType::OVERLAY: {
+        auto overlay = std::make_unique<graph::OverlayRouter<double>>(
+            *graph_, options_.overlay_cell_size, options_.overlay_level_count,
+            options_.precompute_threads);
+        overlay_router_ = overlay.get();
+        router_ = std::move(overlay);
+        break;
+    }
+    case RouterType::RAPTOR:
+        throw std::logic_error("RAPTOR router does not use the graph");
+    }
+}
+
+TransportRouter::AllPairsComponents::Factory TransportRouter::MakeAllPairsFactory() const {
+    return [this](size_t, const graph::DirectedWeightedGraph<double>& graph) {
+        return std::make_unique<graph::Router<double>>(graph, options_.all_pairs_method,
+                                                       options_.precompute_threads);
+    };
+}
+
+TransportRouter::CompactComponents::Factory TransportRouter::MakeCompactFactory(
+    std::vector<graph::FlatRouteTable<float>> tables) const {
+    return [this, tables = std::move(tables)](
+               size_t component, const graph::DirectedWeightedGraph<double>& graph) mutable {
+        if (component < tables.size()) {
+            return std::make_unique<graph::CompactRouter<double>>(graph,
+                                                                  std::move(tables[component]));
+        }
+        return std::make_unique<graph::CompactRouter<double>>(graph, options_.precompute_threads,
+                                                              options_.all_pairs_method);
+    };
+}
+
+std::vector<graph::FlatRouteTable<float>> TransportRouter::TakeCachedTables() {
+    std::vector<graph::FlatRouteTable<float>> tables;
+    if (!cached_tables_) {
+        return tables;
+    }
+    const CachedTables cached = *cached_tables_;
+    cached_tables_.reset();
+
+    // Таблица одна, если граф не разбивается на компоненты
+    const size_t component_count = components_.GetComponentCount();
+    const bool split_tables = component_count > 1;
+    if (cached.table_count != (split_tables ? component_count : 1)) {
+        return tables;
+    }
+    size_t cell_count = 0;
+    for (size_t component = 0; component < cached.table_count; ++component) {
+        const size_t vertex_count = split_tables ? components_.GetVertices(component).size()
+                                                 : graph_->GetVertexCount();
+        cell_count += vertex_count * vertex_count;
+    }
+    if (cell_count != cached.cell_count) {
+        return tables;
+    }
+
+    size_t offset = 0;
+    for (size_t component = 0; component < cached.table_count; ++component) {
+        const size_t vertex_count = split_tables ? components_.GetVertices(component).size()
+                                                 : graph_->GetVertexCount();
+        tables.emplace_back(vertex_count, cached.weights + offset, cached.prev_edges + offset);
+        offset += vertex_count * vertex_count;
+    }
+    return tables;
+}
+
+void TransportRouter::UpdateRouter(const std::vector<graph::EdgeId>& added_edges,
+                                   const std::vector<graph::EdgeId>& removed_edges) {
+    batch_router_ = std::make_unique<graph::DijkstraRouter<double>>(*graph_);
+    if (overlay_router_) {
+        // Разбиение сохраняется, пересчитываются только клики ячеек
+        components_ = graph::GraphComponents(*graph_);
+        overlay_metric_.reset();
+        overlay_router_->Update();
+        return;
+    }
+    if (!all_pairs_router_ && !compact_router_
+        && !component_all_pairs_router_ && !component_compact_router_) {
+        // Поиску без предрасчёта нужны только рабочие массивы под новое число
+        // вершин; кэш деревьев сбрасывается. Иерархия стягивания строится
+        // заново: её shortcut зависят от всех путей через стянутые вершины
+        CreateRouter();
+        return;
+    }
+
+    // Таблица всего графа обновляется, даже если граф распался на компоненты;
+    // у таблиц по компонентам строятся заново только задетые компоненты
+    components_ = graph::GraphComponents(*graph_);
+    if (all_pairs_router_) {
+        all_pairs_router_->Update(added_edges, removed_edges, options_.precompute_threads);
+    } else if (compact_router_) {
+        compact_router_->Update(added_edges, removed_edges, options_.precompute_threads);
+    } else if (component_all_pairs_router_) {
+        component_all_pairs_router_->Update(added_edges, removed_edges, components_,
+                                            MakeAllPairsFactory());
+    } else {
+        component_compact_router_->Update(added_edges, removed_edges, components_,
+                                          MakeCompactFactory());
+    }
+}
+
+std::vector<std::string_view> TransportRouter::GetBusesWithChangedDistances() const {
+    // Перегон задет, если его пара остановок менялась в любую сторону:
+    // GetDistance подставляет обратное расстояние, если прямое не задано
+    std::vector<std::pair<domain::StopId, domain::StopId>> changed_pairs;
+    std::vector<const domain::Bus*> candidates;
+    for (const auto& [from, to] : catalogue_.GetDistanceChanges(synced_version_)) {
+        changed_pairs.emplace_back(std::min(from->id, to->id), std::max(from->id, to->id));
+        const auto& buses = catalogue_.GetBusesForStop(from->id);
+        candidates.insert(candidates.end(), buses.begin(), buses.end());
+    }
+    std::sort(changed_pairs.begin(), changed_pairs.end());
+    std::sort(candidates.begin(), candidates.end(), detail::BusPtrCompare{});
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    auto is_changed = [&changed_pairs](const domain::Stop* lhs, const domain::Stop* rhs) {
+        return std::binary_search(changed_pairs.begin(), changed_pairs.end(),
+                                  std::pair{std::min(lhs->id, rhs->id), std::max(lhs->id, rhs->id)});
+    };
+    // Перегоны — те же, что у MakeBusEdges и SplitIntoRidePatterns, вместе с замыканием кольца
+    std::vector<std::string_view> names;
+    for (const domain::Bus* bus : candidates) {
+        const auto& stops = bus->stops;
+        bool changed = bus->is_roundtrip && stops.size() >= 2 && is_changed(stops.back(), stops.front());
+        for (size_t i = 0; !changed && i + 1 < stops.size(); ++i) {
+            changed = is_changed(stops[i], stops[i + 1]);
+        }
+        if (changed) {
+            names.push_back(bus->name);
+        }
+    }
+    return names;
+}
+
+void TransportRouter::UpdateBus(std::string_view name) {
+    std::unique_lock lock(search_mutex_);
+    if (answer_cache_) {
+        answer_cache_->Clear();
+    }
+    // Рёбра строятся заново для самого автобуса и для автобусов, у которых после
+    // прошлого обновления изменилось расстояние хотя бы одного перегона
+    std::vector<std::string_view> names = GetBusesWithChangedDistances();
+    names.push_back(name);
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    synced_version_ = catalogue_.GetVersion();
+    auto is_updated = [&names](std::string_view bus_name) {
+        return std::binary_search(names.begin(), names.end(), bus_name);
+    };
+
+    if (raptor_) {
+        // Отрезки RAPTOR строятся за миллисекунды, проще собрать их заново
+        raptor_ = std::make_unique<RaptorRouter>(catalogue_, settings_);
+        return;
+    }
+    if (!graph_) {
+        return;
+    }
+
+    graph_->Thaw();
+
+    // Рёбра прежних версий автобусов; вершины поездки LINEAR_RIDES остаются без рёбер.
+    // Ребро, у которого есть равноценный автобус не из обновляемых, остаётся
+    // в графе с тем же весом и переходит к нему
+    std::vector<graph::EdgeId> removed_edges;
+    for (graph::EdgeId edge_id = 0; edge_id < edge_info_.size(); ++edge_id) {
+        ExtendedEdge& edge = edge_info_[edge_id];
+        if (!edge.bus_ptr || !is_updated(edge.bus_ptr->name)) {
+            continue;
+        }
+        const auto [first, last] = std::equal_range(
+            equivalent_buses_.begin(), equivalent_buses_.end(), EquivalentBus{edge_id},
+            [](const EquivalentBus& lhs, const EquivalentBus& rhs) {
+                return lhs.edge_id < rhs.edge_id;
+            });
+        const auto replacement = std::find_if(first, last, [&](const EquivalentBus& equivalent) {
+            return equivalent.bus && !is_updated(equivalent.bus->name);
+        });
+        if (replacement != last) {
+            edge.bus_ptr = replacement->bus;
+            edge.span_count = replacement->span_count;
+            replacement->bus = nullptr;
+            continue;
+        }
+        removed_edges.push_back(edge_id);
+        graph_->RemoveEdge(edge_id);
+        edge.bus_ptr = nullptr;
+    }
+    equivalent_buses_.erase(
+        std::remove_if(equivalent_buses_.begin(), equivalent_buses_.end(),
+                       [&](const EquivalentBus& equivalent) {
+                           return !equivalent.bus || is_updated(equivalent.bus->name);
+                       }),
+        equivalent_buses_.end());
+
+    const graph::EdgeId first_added_edge = graph_->GetEdgeCount();
+    if (options_.dedup_parallel_edges && options_.graph_model == GraphModel::SPAN_EDGES) {
+        RestoreDroppedEdges(removed_edges, names);
+    }
+    for (const std::string_view bus_name : names) {
+        const domain::Bus* bus = catalogue_.GetBus(bus_name);
+        if (!bus) {
+            continue;
+        }
+        // Остановки, которые раньше не обслуживал ни один автобус, получают вершины
+        stop_to_vertex_.resize(catalogue_.GetStopCount(), NO_VERTEX);
+        for (const domain::Stop* stop : bus->stops) {
+            if (stop_to_vertex_[stop->id] != NO_VERTEX) {
+                continue;
+            }
+            stop_to_vertex_[stop->id] = graph_->AddVertices(1);
+            vertex_to_stop_.push_back(stop);
+        }
+
+        if (options_.graph_model == GraphModel::LINEAR_RIDES) {
+            for (const auto& pattern : SplitIntoRidePatterns(catalogue_, bus)) {
+                const graph::VertexId first_ride_vertex = graph_->AddVertices(pattern.stops.size());
+                vertex_to_stop_.resize(graph_->GetVertexCount());
+                AddRideEdgesForPattern(pattern, first_ride_vertex);
+            }
+        } else {
+            // Новые рёбра не сливаются с рёбрами графа: параллельные рёбра
+            // не меняют ответов, только число рёбер
+            AddBusEdgesForRoute(bus);
+        }
+    }
+
+    std::vector<graph::EdgeId> added_edges;
+    for (graph::EdgeId edge_id = first_added_edge; edge_id < graph_->GetEdgeCount(); ++edge_id) {
+        added_edges.push_back(edge_id);
+    }
+
+    graph_->Freeze();
+    UpdateRouter(added_edges, removed_edges);
+}
+
+namespace {
+
+double ChordLength(double dx, double dy, double dz) {
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+// Ответ для остановки без автобусов: её нет в графе, и доехать можно только до неё самой
+std::optional<RouteData> MakeEmptyRoute(const domain::Stop* from, const domain::Stop* to) {
+    if (from != to) {
+        return std::nullopt;
+    }
+    return RouteData{};
+}
+
+} // namespace
+
+void TransportRouter::PrepareHeuristic() {
+    // Остановки переводятся в точки на сфере радиуса Земли: длина хорды между
+    // ними не больше расстояния по дуге большого круга и, в отличие от acos,
+    // вычисляется без потери точности на близких точках.
+    static const double dr = 3.1415926535 / 180.;
+    static const double earth_radius = 6371000;
+    vertex_points_.resize(vertex_to_stop_.size());
+    is_stop_vertex_.assign(vertex_to_stop_.size(), false);
+    for (const graph::VertexId stop_vertex : stop_to_vertex_) {
+        if (stop_vertex != NO_VERTEX) {
+            is_stop_vertex_[stop_vertex] = true;
+        }
+    }
+    for (graph::VertexId vertex = 0; vertex < vertex_to_stop_.size(); ++vertex) {
+        const auto& coordinates = vertex_to_stop_[vertex]->coordinates;
+        vertex_points_[vertex] = {
+            earth_radius * std::cos(coordinates.lat * dr) * std::cos(coordinates.lng * dr),
+            earth_radius * std::cos(coordinates.lat * dr) * std::sin(coordinates.lng * dr),
+            earth_radius * std::sin(coordinates.lat * dr)
+        };
+    }
+
+    // Дорожное расстояние может быть короче прямого, поэтому оценка масштабируется
+    // на минимальное по всем перегонам отношение дорожного расстояния к хорде.
+    // Тогда по неравенству треугольника время любого пути до цели
+    // не меньше heuristic_scale_ * хорда до цели.
+    // Перегоны берутся те же, из которых MakeBusEdges и SplitIntoRidePatterns
+    // собирают рёбра: прямые, обратные у некольцевых маршрутов и замыкание кольца
+    double min_ratio = 1.0;
+    bool has_segments = false;
+    auto add_segment = [&](const domain::Stop* from_stop, const domain::Stop* to_stop) {
+        const int road_distance = catalogue_.GetDistance(from_stop, to_stop);
+        const graph::VertexId from_vertex = GetStopVertex(from_stop);
+        const graph::VertexId to_vertex = GetStopVertex(to_stop);
+        if (road_distance <= 0 || from_vertex == NO_VERTEX || to_vertex == NO_VERTEX) {
+            return;
+        }
+        const auto& from_point = vertex_points_[from_vertex];
+        const auto& to_point = vertex_points_[to_vertex];
+        const double chord = ChordLength(from_point.x - to_point.x,
+                                         from_point.y - to_point.y,
+                                         from_point.z - to_point.z);
+        if (chord > 0) {
+            const double ratio = road_distance / chord;
+            min_ratio = has_segments ? std::min(min_ratio, ratio) : ratio;
+            has_segments = true;
+        }
+    };
+    for (const auto& [bus_name, bus] : catalogue_.GetBusnameToBus()) {
+        const auto& stops = bus->stops;
+        for (size_t i = 0; i + 1 < stops.size(); ++i) {
+            add_segment(stops[i], stops[i + 1]);
+            if (!bus->is_roundtrip) {
+                add_segment(stops[i + 1], stops[i]);
+            }
+        }
+        if (bus->is_roundtrip && stops.size() >= 2) {
+            add_segment(stops.back(), stops.front());
+        }
+    }
+
+    const double speed_m_per_min = settings_.bus_velocity * 1000.0 / 60.0;
+    heuristic_scale_ = has_segments && speed_m_per_min > 0 ? min_ratio / speed_m_per_min : 0.0;
+}
+
+double TransportRouter::EstimateTime(graph::VertexId vertex, graph::VertexId target) const {
+    const auto& point = vertex_points_[vertex];
+    const auto& target_point = vertex_points_[target];
+    double estimate = heuristic_scale_ * ChordLength(point.x - target_point.x,
+                                                     point.y - target_point.y,
+                                                     point.z - target_point.z);
+
+    // С другой остановки к цели не уехать без ожидания автобуса: оно входит
+    // в вес каждого ребра, выходящего из вершины остановки
+    if (is_stop_vertex_[vertex] && vertex_to_stop_[vertex] != vertex_to_stop_[target]) {
+        estimate += settings_.bus_wait_time;
+    }
+    return estimate;
+}
+
+namespace {
+
+// Формат файла кэша (порядок байт и выравнивание — как у процесса, записавшего файл;
+// файл с другой платформы отбрасывается по несовпадению версии или размера):
+//   CacheHeader
+//   uint32_t[vertex_count]  — StopId остановки каждой вершины; первые stop_vertex_count
+//                             вершин — вершины остановок, за ними вершины поездки
+//   CachedEdge[edge_count]  — рёбра графа в порядке EdgeId (с выравниванием)
+//   CachedEquivalentBus[equivalent_count] — равноценные автобусы рёбер
+//   float[table_cell_count] — веса таблиц CompactRouter (с выравниванием), если
+//                             table_count > 0: таблица всего графа или таблицы
+//                             компонент подряд, в порядке номеров компонент
+//   uint32_t[table_cell_count] — последние рёбра путей таблиц в том же порядке
+//   char[labels_size]       — блок HubLabels (с выравниванием), если labels_size > 0
+// payload_checksum покрывает всё после заголовка вместе с выравниванием: таблицы
+// и метки отображаются без разбора, и повреждённый файл иначе дал бы неверные
+// маршруты или обращение за пределы графа
+constexpr char CACHE_MAGIC[8] = {'T', 'C', 'R', 'O', 'U', 'T', 'E', '\0'};
+constexpr uint32_t CACHE_VERSION = 9;
+constexpr size_t CACHE_TABLE_ALIGNMENT = 64;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t table_count;
+    uint64_t key;
+    // Настройки, для которых построены таблица и метки; веса рёбер считаются
+    // из расстояний при загрузке, и граф подходит для любых настроек
+    int64_t bus_wait_time;
+    double bus_velocity;
+    uint64_t stop_count;
+    uint64_t stop_vertex_count;
+    uint64_t vertex_count;
+    uint64_t edge_count;
+    uint64_t equivalent_count;
+    uint64_t table_cell_count;
+    uint64_t labels_size;
+    uint64_t file_size;
+    uint64_t payload_checksum;
+};
+
+struct CachedEdge {
+    uint64_t from;
+    uint64_t to;
+    int32_t bus_index;  // BusId автобуса
+    int32_t span_count;
+    int32_t kind;
+    int32_t distance;
+};
+
+struct CachedEquivalentBus {
+    uint32_t edge_id;
+    int32_t bus_index;  // BusId автобуса
+    int32_t span_count;
+};
+
+struct CacheLayout {
+    size_t edges_offset = 0;
+    size_t equivalents_offset = 0;
+    size_t weights_offset = 0;
+    size_t prev_edges_offset = 0;
+    size_t labels_offset = 0;
+    size_t file_size = 0;
+};
+
+size_t AlignUp(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+CacheLayout ComputeCacheLayout(size_t vertex_count, size_t edge_count, size_t equivalent_count,
+                               size_t table_cell_count, size_t labels_size) {
+    CacheLayout layout;
+    layout.edges_offset = AlignUp(sizeof(CacheHeader) + vertex_count * sizeof(uint32_t),
+                                  alignof(CachedEdge));
+    layout.equivalents_offset = layout.edges_offset + edge_count * sizeof(CachedEdge);
+    layout.file_size = layout.equivalents_offset
+        + equivalent_count * sizeof(CachedEquivalentBus);
+    if (table_cell_count > 0) {
+        layout.weights_offset = AlignUp(layout.file_size, CACHE_TABLE_ALIGNMENT);
+        layout.prev_edges_offset = layout.weights_offset + table_cell_count * sizeof(float);
+        layout.file_size = layout.prev_edges_offset + table_cell_count * sizeof(uint32_t);
+    }
+    if (labels_size > 0) {
+        layout.labels_offset = AlignUp(layout.file_size, CACHE_TABLE_ALIGNMENT);
+        layout.file_size = layout.labels_offset + labels_size;
+    }
+    return layout;
+}
+
+// FNV-1a: в отличие от std::hash, результат не зависит от процесса и сборки
+class CacheKeyHasher {
+public:
+    void Add(const void* data, size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash_ = (hash_ ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+
+    template <typename Value>
+    void AddValue(const Value& value) {
+        static_assert(std::is_trivially_copyable_v<Value>);
+        Add(&value, sizeof(value));
+    }
+
+    void AddString(std::string_view text) {
+        AddValue(text.size());
+        Add(text.data(), text.size());
+    }
+
+    uint64_t GetHash() const {
+        return hash_;
+    }
+
+private:
+    uint64_t hash_ = 14695981039346656037ULL;
+};
+
+// Контрольная сумма содержимого файла кэша. Данные смешиваются по 8 байт:
+// таблицы занимают сотни мегабайт, и побайтовый FNV-1a заметно замедлил бы
+// загрузку. Результат не зависит от того, какими частями переданы данные
+class CacheChecksum {
+public:
+    void Add(const void* data, size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        total_size_ += size;
+        while (size > 0 && pending_size_ > 0) {
+            AddPendingByte(*bytes++);
+            --size;
+        }
+        for (; size >= sizeof(uint64_t); bytes += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+            Mix(word);
+        }
+        for (; size > 0; --size) {
+            AddPendingByte(*bytes++);
+        }
+    }
+
+    uint64_t GetChecksum() const {
+        uint64_t hash = hash_;
+        if (pending_size_ > 0) {
+            hash = (hash ^ pending_) * PRIME;
+        }
+        return (hash ^ total_size_) * PRIME;
+    }
+
+private:
+    static constexpr uint64_t PRIME = 1099511628211ULL;
+
+    void Mix(uint64_t word) {
+        hash_ = (hash_ ^ word) * PRIME;
+        hash_ ^= hash_ >> 29;
+    }
+
+    void AddPendingByte(unsigned char byte) {
+        pending_ |= static_cast<uint64_t>(byte) << (8 * pending_size_);
+        if (++pending_size_ == sizeof(uint64_t)) {
+            Mix(pending_);
+            pending_ = 0;
+            pending_size_ = 0;
+        }
+    }
+
+    uint64_t hash_ = 14695981039346656037ULL;
+    uint64_t pending_ = 0;
+    size_t pending_size_ = 0;
+    uint64_t total_size_ = 0;
+};
+
+// Запись содержимого файла кэша после заголовка с подсчётом его контрольной суммы
+class CacheWriter {
+public:
+    explicit CacheWriter(std::ostream& out)
+        : out_(out) {
+    }
+
+    void Write(const void* data, size_t size) {
+        out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        checksum_.Add(data, size);
+    }
+
+    template <typename Value>
+    void WriteValue(const Value& value) {
+        static_assert(std::is_trivially_copyable_v<Value>);
+        Write(&value, sizeof(value));
+    }
+
+    void WriteZeros(size_t count) {
+        static const char zeros[CACHE_TABLE_ALIGNMENT] = {};
+        Write(zeros, count);
+    }
+
+    uint64_t GetChecksum() const {
+        return checksum_.GetChecksum();
+    }
+
+private:
+    std::ostream& out_;
+    CacheChecksum checksum_;
+};
+
+} // namespace
+
+uint64_t TransportRouter::ComputeCacheKey() const {
+    // Ключ покрывает всё, от чего зависит граф: модель графа и слияние рёбер,
+    // остановки, маршруты и расстояния между соседними остановками маршрутов
+    CacheKeyHasher hasher;
+    hasher.AddValue(options_.graph_model);
+    hasher.AddValue(options_.dedup_parallel_edges);
+
+    // Вершины и рёбра в файле ссылаются на StopId и BusId, поэтому важен и порядок
+    // добавления: справочник из тех же данных в другом порядке не подойдёт
+    for (domain::StopId id = 0; id < catalogue_.GetStopCount(); ++id) {
+        const domain::Stop* stop = catalogue_.GetStopById(id);
+        hasher.AddString(stop->name);
+        hasher.AddValue(stop->coordinates.lat);
+        hasher.AddValue(stop->coordinates.lng);
+    }
+
+    for (domain::BusId id = 0; id < catalogue_.GetBusCount(); ++id) {
+        const domain::Bus* bus = catalogue_.GetBusById(id);
+        hasher.AddString(bus->name);
+        hasher.AddValue(bus->is_roundtrip);
+        hasher.AddValue(bus->stops.size());
+        for (size_t i = 0; i < bus->stops.size(); ++i) {
+            const domain::Stop* stop = bus->stops[i];
+            const domain::Stop* next_stop = bus->stops[(i + 1) % bus->stops.size()];
+            hasher.AddString(stop->name);
+            hasher.AddValue(catalogue_.GetDistance(stop, next_stop));
+            hasher.AddValue(catalogue_.GetDistance(next_stop, stop));
+        }
+    }
+    return hasher.GetHash();
+}
+
+bool TransportRouter::LoadCache() {
+    io::MappedFile file;
+    try {
+        file = io::MappedFile(options_.cache_path);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+
+    CacheHeader header;
+    if (file.GetSize() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.GetData(), sizeof(header));
+
+    const size_t stop_count = catalogue_.GetStopCount();
+    const size_t bus_count = catalogue_.GetBusCount();
+    const bool need_table = options_.type == RouterType::COMPACT_ALL_PAIRS;
+    const bool need_labels = options_.type == RouterType::HUB_LABELS;
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.version != CACHE_VERSION
+        || header.key != ComputeCacheKey()
+        || header.file_size != file.GetSize()
+        || header.stop_count != stop_count
+        || header.stop_vertex_count > stop_count
+        || header.vertex_count < header.stop_vertex_count) {
+        return false;
+    }
+    // Таблица и метки другого профиля настроек не подходят: они пересчитываются
+    // по загруженному графу
+    const bool same_settings = header.bus_wait_time == settings_.bus_wait_time
+        && header.bus_velocity == settings_.bus_velocity;
+    const bool use_table = need_table && header.table_count > 0 && same_settings;
+    const bool use_labels = need_labels && header.labels_size > 0 && same_settings;
+
+    const size_t vertex_count = header.vertex_count;
+    const size_t edge_count = header.edge_count;
+    const size_t equivalent_count = header.equivalent_count;
+    const CacheLayout layout = ComputeCacheLayout(vertex_count, edge_count, equivalent_count,
+                                                  header.table_cell_count, header.labels_size);
+    if (layout.file_size != file.GetSize()) {
+        return false;
+    }
+    CacheChecksum checksum;
+    checksum.Add(file.GetData() + sizeof(CacheHeader), file.GetSize() - sizeof(CacheHeader));
+    if (checksum.GetChecksum() != header.payload_checksum) {
+        return false;
+    }
+
+    const auto* vertex_stops = reinterpret_cast<const uint32_t*>(
+        file.GetData() + sizeof(CacheHeader));
+    const auto* cached_edges = reinterpret_cast<const CachedEdge*>(
+        file.GetData() + layout.edges_offset);
+    const auto* cached_equivalents = reinterpret_cast<const CachedEquivalentBus*>(
+        file.GetData() + layout.equivalents_offset);
+
+    vertex_to_stop_.assign(vertex_count, nullptr);
+    edge_info_.clear();
+    edge_info_.reserve(edge_count);
+    for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        if (vertex_stops[vertex] >= stop_count) {
+            return false;
+        }
+        vertex_to_stop_[vertex] = catalogue_.GetStopById(vertex_stops[vertex]);
+    }
+    stop_to_vertex_.assign(stop_count, NO_VERTEX);
+    for (graph::VertexId vertex = 0; vertex < header.stop_vertex_count; ++vertex) {
+        graph::VertexId& stop_vertex = stop_to_vertex_[vertex_to_stop_[vertex]->id];
+        if (stop_vertex != NO_VERTEX) {
+            return false;
+        }
+        stop_vertex = vertex;
+    }
+
+    graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(vertex_count);
+    for (size_t edge_id = 0; edge_id < edge_count; ++edge_id) {
+        const CachedEdge& cached = cached_edges[edge_id];
+        const auto kind = static_cast<EdgeKind>(cached.kind);
+        if (cached.from >= vertex_count || cached.to >= vertex_count
+            || cached.kind < static_cast<int32_t>(EdgeKind::BUS)
+            || cached.kind > static_cast<int32_t>(EdgeKind::ALIGHT)
+            || cached.bus_index < 0
+            || static_cast<size_t>(cached.bus_index) >= bus_count) {
+            graph_.reset();
+            return false;
+        }
+        AddEdge({cached.from, cached.to, GetEdgeWeight(kind, cached.distance, settings_),
+                 catalogue_.GetBusById(cached.bus_index), cached.span_count, kind,
+                 cached.distance});
+    }
+
+    equivalent_buses_.clear();
+    equivalent_buses_.reserve(equivalent_count);
+    for (size_t i = 0; i < equivalent_count; ++i) {
+        const CachedEquivalentBus& cached = cached_equivalents[i];
+        if (cached.edge_id >= edge_count
+            || (i > 0 && cached.edge_id < cached_equivalents[i - 1].edge_id)
+            || cached.bus_index < 0
+            || static_cast<size_t>(cached.bus_index) >= bus_count) {
+            graph_.reset();
+            return false;
+        }
+        equivalent_buses_.push_back({cached.edge_id, catalogue_.GetBusById(cached.bus_index),
+                                     cached.span_count});
+    }
+
+    if (header.table_count > 0 && same_settings) {
+        const CachedTables file_tables{
+            reinterpret_cast<const float*>(file.GetData() + layout.weights_offset),
+            reinterpret_cast<const uint32_t*>(file.GetData() + layout.prev_edges_offset),
+            header.table_count, header.table_cell_count};
+        // Разбиение таблиц сверяется с компонентами графа в TakeCachedTables
+        if (use_table) {
+            cached_tables_ = file_tables;
+        } else {
+            kept_tables_ = file_tables;
+        }
+    }
+    if (header.labels_size > 0 && same_settings && !use_labels) {
+        kept_labels_ = std::string_view(file.GetData() + layout.labels_offset, header.labels_size);
+    }
+    if (use_labels) {
+        cached_labels_ = graph::HubLabels<double>::FromBlob(file.GetData() + layout.labels_offset,
+                                                            header.labels_size);
+        if (!cached_labels_ || cached_labels_->GetVertexCount() != vertex_count) {
+            cached_labels_.reset();
+            graph_.reset();
+            return false;
+        }
+    }
+    cache_file_ = std::move(file);
+    loaded_from_cache_ = true;
+    CreateRouter();
+    // Файл записан маршрутизатором другого типа или для других настроек:
+    // построенные заново таблица или метки дописываются в файл, иначе их
+    // пересчитывал бы каждый запуск
+    if ((need_table && !use_table) || (need_labels && !use_labels)) {
+        SaveCache();
+    }
+    kept_tables_.reset();
+    kept_labels_ = {};
+    return true;
+}
+
+bool TransportRouter::SaveCache() const {
+    const size_t vertex_count = graph_->GetVertexCount();
+    const size_t edge_count = graph_->GetEdgeCount();
+    const size_t equivalent_count = equivalent_buses_.size();
+    std::vector<const graph::FlatRouteTable<float>*> tables;
+    if (compact_router_) {
+        tables.push_back(&compact_router_->GetTable());
+    } else if (component_compact_router_) {
+        for (size_t component = 0; component < components_.GetComponentCount(); ++component) {
+            tables.push_back(&component_compact_router_->GetRouter(component).GetTable());
+        }
+    }
+    size_t table_count = tables.size();
+    size_t table_cell_count = 0;
+    for (const auto* table : tables) {
+        table_cell_count += table->GetVertexCount() * table->GetVertexCount();
+    }
+    // Разделы, которые этот маршрутизатор не строит, переносятся из прежнего файла
+    const bool write_kept_tables = tables.empty() && kept_tables_;
+    if (write_kept_tables) {
+        table_count = kept_tables_->table_count;
+        table_cell_count = kept_tables_->cell_count;
+    }
+    const std::string_view labels = hub_label_router_
+        ? std::string_view(hub_label_router_->GetLabels().GetBlobData(),
+                           hub_label_router_->GetLabels().GetBlobSize())
+        : kept_labels_;
+    const size_t labels_size = labels.size();
+    const CacheLayout layout = ComputeCacheLayout(vertex_count, edge_count, equivalent_count,
+                                                  table_cell_count, labels_size);
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.table_count = static_cast<uint32_t>(table_count);
+    header.key = ComputeCacheKey();
+    header.bus_wait_time = settings_.bus_wait_time;
+    header.bus_velocity = settings_.bus_velocity;
+    header.stop_count = catalogue_.GetStopCount();
+    // Сохраняется только граф из BuildGraph, где вершины остановок идут первыми
+    header.stop_vertex_count = stop_to_vertex_.size()
+        - std::count(stop_to_vertex_.begin(), stop_to_vertex_.end(), NO_VERTEX);
+    header.vertex_count = vertex_count;
+    header.edge_count = edge_count;
+    header.equivalent_count = equivalent_count;
+    header.table_cell_count = table_cell_count;
+    header.labels_size = labels_size;
+    header.file_size = layout.file_size;
+
+    // Запись во временный файл и переименование: процессы, уже отобразившие
+    // старый файл, продолжают читать его, а новые не увидят недописанный
+    const std::string temp_path = options_.cache_path + ".tmp." + std::to_string(::getpid());
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        // Заголовок дописывается после содержимого, когда известна контрольная сумма
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        CacheWriter writer(out);
+
+        for (const domain::Stop* stop : vertex_to_stop_) {
+            const uint32_t stop_index = stop->id;
+            writer.WriteValue(stop_index);
+        }
+        writer.WriteZeros(layout.edges_offset - sizeof(header) - vertex_count * sizeof(uint32_t));
+
+        for (graph::EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            const auto& edge = edge_info_[edge_id];
+            const CachedEdge cached{edge.from, edge.to, static_cast<int32_t>(edge.bus_ptr->id),
+                                    edge.span_count, static_cast<int32_t>(edge.kind),
+                                    edge.distance};
+            writer.WriteValue(cached);
+        }
+
+        for (const EquivalentBus& equivalent : equivalent_buses_) {
+            const CachedEquivalentBus cached{static_cast<uint32_t>(equivalent.edge_id),
+                                             static_cast<int32_t>(equivalent.bus->id),
+                                             equivalent.span_count};
+            writer.WriteValue(cached);
+        }
+
+        if (table_cell_count > 0) {
+            writer.WriteZeros(layout.weights_offset - layout.equivalents_offset
+                              - equivalent_count * sizeof(CachedEquivalentBus));
+            for (const auto* table : tables) {
+                const size_t cell_count = table->GetVertexCount() * table->GetVertexCount();
+                writer.Write(table->GetWeightRow(0), cell_count * sizeof(float));
+            }
+            for (const auto* table : tables) {
+                const size_t cell_count = table->GetVertexCount() * table->GetVertexCount();
+                writer.Write(table->GetPrevEdgeRow(0), cell_count * sizeof(uint32_t));
+            }
+            if (write_kept_tables) {
+                writer.Write(kept_tables_->weights, table_cell_count * sizeof(float));
+                writer.Write(kept_tables_->prev_edges, table_cell_count * sizeof(uint32_t));
+            }
+        }
+
+        if (labels_size > 0) {
+            writer.WriteZeros(layout.labels_offset - static_cast<size_t>(out.tellp()));
+            writer.Write(labels.data(), labels_size);
+        }
+
+        header.payload_checksum = writer.GetChecksum();
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!out.flush()) {
+            out.close();
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temp_path.c_str(), options_.cache_path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TransportRouter::IsLoadedFromCache() const {
+    return loaded_from_cache_;
+}
+
+size_t TransportRouter::GetLastSettledCount() const {
+    std::shared_lock lock(search_mutex_);
+    if (raptor_) {
+        return raptor_->GetScannedCount();
+    }
+    return router_ ? router_->GetSettledCount() : 0;
+}
+
+std::optional<cache::ClockCacheStats> TransportRouter::GetAnswerCacheStats() const {
+    if (!answer_cache_) {
+        return std::nullopt;
+    }
+    return answer_cache_->GetStats();
+}
+
+std::optional<graph::TreeCacheStats> TransportRouter::GetTreeCacheStats() const {
+    std::shared_lock lock(search_mutex_);
+    if (!tree_cache_) {
+        return std::nullopt;
+    }
+    return tree_cache_->GetStats();
 }
 
 void TransportRouter::BuildGraph() {
     // Очищаем предыдущие данные
     stop_to_vertex_.clear();
+    vertex_to_stop_.clear();
     edge_info_.clear();
+    equivalent_buses_.clear();
     
     // 1. Получаем все остановки
-    const auto& stops = catalogue_.GetStopnameToStop();
-    if (stops.empty()) {
+    const size_t stop_count = catalogue_.GetStopCount();
+    if (stop_count == 0) {
         graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(0);
-        router_ = std::make_unique<graph::Router<double>>(*graph_);
+        CreateRouter();
         return;
     }
     
-    // 2. Создаем вершины для каждой остановки (2 вершины на остановку)
-    size_t vertex_count = stops.size() * 2;
+    // 2. Создаем по вершине для каждой остановки, через которую идёт хотя бы один
+    // автобус, и для LINEAR_RIDES — по вершине на каждую позицию каждого отрезка
+    // маршрута. Остановки без автобусов в граф не попадают
+    size_t vertex_count = 0;
+    for (domain::StopId id = 0; id < stop_count; ++id) {
+        vertex_count += !catalogue_.GetBusesForStop(id).empty();
+    }
+    std::vector<RidePattern> ride_patterns;
+    if (options_.graph_model == GraphModel::LINEAR_RIDES) {
+        for (const auto& [bus_name, bus] : catalogue_.GetBusnameToBus()) {
+            for (auto& pattern : SplitIntoRidePatterns(catalogue_, bus)) {
+                vertex_count += pattern.stops.size();
+                ride_patterns.push_back(std::move(pattern));
+            }
+        }
+    }
     graph_ = std::make_unique<graph::DirectedWeightedGraph<double>>(vertex_count);
     
-    // 3. Сопоставляем остановкам вершины
+    // 3. Сопоставляем остановкам вершины в порядке StopId
     graph::VertexId vertex_id = 0;
-    for (const auto& [name, stop] : stops) {
-        stop_to_vertex_[stop] = vertex_id;
-        vertex_id += 2; // 2 вершины на остановку
-    }
-    
-    // 4. Добавляем рёбра ожидания (от вершины ожидания к вершине посадки)
-    for (const auto& [stop_ptr, wait_vertex] : stop_to_vertex_) {
-        graph::Edge<double> wait_edge{
-            wait_vertex,                    // from - вершина ожидания
-            wait_vertex + 1,                // to - вершина посадки
-            static_cast<double>(settings_.bus_wait_time) // вес - время ожидания
-        };
-        
-        auto edge_id = graph_->AddEdge(wait_edge);
-        edge_info_[edge_id] = {wait_vertex, wait_vertex + 1, 
-                              static_cast<double>(settings_.bus_wait_time),
-                              nullptr, 0, true};
+    vertex_to_stop_.resize(vertex_count);
+    stop_to_vertex_.assign(stop_count, NO_VERTEX);
+    for (domain::StopId id = 0; id < stop_count; ++id) {
+        if (catalogue_.GetBusesForStop(id).empty()) {
+            continue;
+        }
+        stop_to_vertex_[id] = vertex_id;
+        vertex_to_stop_[vertex_id] = catalogue_.GetStopById(id);
+        ++vertex_id;
     }
     
-    // 5. Добавляем рёбра поездки на автобусах
-    for (const auto& [bus_name, bus] : catalogue_.GetBusnameToBus()) {
-        AddBusEdgesForRoute(bus);
+    // 4. Добавляем рёбра поездки на автобусах; ожидание входит в вес рёбер,
+    // выходящих из вершины остановки
+    if (options_.graph_model == GraphModel::LINEAR_RIDES) {
+        for (const auto& pattern : ride_patterns) {
+            AddRideEdgesForPattern(pattern, vertex_id);
+            vertex_id += pattern.stops.size();
+        }
+    } else {
+        std::vector<const domain::Bus*> buses;
+        buses.reserve(catalogue_.GetBusnameToBus().size());
+        for (const auto& [bus_name, bus] : catalogue_.GetBusnameToBus()) {
+            buses.push_back(bus);
+        }
+        AddBusEdges(buses);
     }
     
-    // 6. Создаем роутер
-    router_ = std::make_unique<graph::Router<double>>(*graph_);
+    // 5. Создаем роутер выбранного типа
+    CreateRouter();
 }
 
 void TransportRouter::AddBusEdgesForRoute(const domain::Bus* bus) {
+    std::vector<ExtendedEdge> edges;
+    MakeBusEdges(bus, edges);
+    for (const ExtendedEdge& edge : edges) {
+        AddEdge(edge);
+    }
+}
+
+void TransportRouter::AddBusEdges(const std::vector<const domain::Bus*>& buses) {
+    // Рёбра автобусов строятся параллельно в буферы исполнителей. Буфер хранит
+    // рёбра своих автобусов подряд, а bus_ranges — где лежат рёбра каждого
+    // автобуса, поэтому рёбра попадают в граф в порядке buses при любом
+    // распределении автобусов по потокам
+    struct BusRange {
+        size_t worker = 0;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    parallel::ThreadPool pool(options_.precompute_threads);
+    std::vector<std::vector<ExtendedEdge>> buffers(pool.GetThreadCount());
+    std::vector<BusRange> bus_ranges(buses.size());
+    pool.ParallelFor(buses.size(), [&](size_t index, size_t worker) {
+        std::vector<ExtendedEdge>& buffer = buffers[worker];
+        const size_t begin = buffer.size();
+        MakeBusEdges(buses[index], buffer);
+        bus_ranges[index] = {worker, begin, buffer.size()};
+    });
+
+    if (options_.dedup_parallel_edges) {
+        std::vector<const ExtendedEdge*> edges;
+        for (const BusRange& range : bus_ranges) {
+            const auto& buffer = buffers[range.worker];
+            for (size_t i = range.begin; i < range.end; ++i) {
+                edges.push_back(&buffer[i]);
+            }
+        }
+        AddDedupedEdges(edges, pool);
+        return;
+    }
+
+    size_t edge_count = 0;
+    for (const auto& buffer : buffers) {
+        edge_count += buffer.size();
+    }
+    graph_->ReserveEdges(edge_count);
+    edge_info_.reserve(edge_info_.size() + edge_count);
+
+    for (const BusRange& range : bus_ranges) {
+        const auto& buffer = buffers[range.worker];
+        for (size_t i = range.begin; i < range.end; ++i) {
+            AddEdge(buffer[i]);
+        }
+    }
+}
+
+void TransportRouter::AddDedupedEdges(const std::vector<const ExtendedEdge*>& edges,
+                                      parallel::ThreadPool& pool) {
+    // Вес ребра BUS растёт с расстоянием, поэтому из рёбер с общими концами
+    // достаточно самого короткого. Рёбра упорядочиваются по концам и расстоянию,
+    // при равенстве — по порядку добавления: остаётся то же ребро, которое
+    // выбрал бы поиск в графе со всеми рёбрами. Петли никогда не сокращают путь
+    // Сначала раскладка по начальной вершине подсчётом, затем сортировка внутри
+    // каждой вершины: исходящих рёбер у вершины немного
+    const size_t vertex_count = graph_->GetVertexCount();
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (const ExtendedEdge* edge : edges) {
+        ++offsets[edge->from + 1];
+    }
+    for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+        offsets[vertex + 1] += offsets[vertex];
+    }
+    std::vector<uint32_t> order(edges.size());
+    {
+        std::vector<uint32_t> positions(offsets.begin(), offsets.end() - 1);
+        for (uint32_t i = 0; i < edges.size(); ++i) {
+            order[positions[edges[i]->from]++] = i;
+        }
+    }
+    pool.ParallelFor(vertex_count, [&](size_t vertex, size_t) {
+        std::sort(order.begin() + offsets[vertex], order.begin() + offsets[vertex + 1],
+                  [&edges](uint32_t lhs, uint32_t rhs) {
+                      return std::tie(edges[lhs]->to, edges[lhs]->distance, lhs)
+                           < std::tie(edges[rhs]->to, edges[rhs]->distance, rhs);
+                  });
+    });
+
+    // Для каждого ребра — индекс оставленного ребра с тем же расстоянием
+    constexpr uint32_t DROPPED = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> kept(edges.size(), DROPPED);
+    size_t kept_count = 0;
+    for (size_t begin = 0; begin < order.size();) {
+        const ExtendedEdge& best = *edges[order[begin]];
+        size_t end = begin + 1;
+        while (end < order.size() && edges[order[end]]->from == best.from
+               && edges[order[end]]->to == best.to) {
+            ++end;
+        }
+        if (best.from != best.to) {
+            ++kept_count;
+            for (size_t i = begin; i < end && edges[order[i]]->distance == best.distance; ++i) {
+                kept[order[i]] = order[begin];
+            }
+        }
+        begin = end;
+    }
+
+    graph_->ReserveEdges(kept_count);
+    edge_info_.reserve(edge_info_.size() + kept_count);
+    std::vector<graph::EdgeId> edge_ids(edges.size());
+    for (uint32_t i = 0; i < edges.size(); ++i) {
+        if (kept[i] == i) {
+            edge_ids[i] = graph_->GetEdgeCount();
+            AddEdge(*edges[i]);
+        }
+    }
+
+    // Равноценные автобусы идут по возрастанию EdgeId оставленного ребра, один
+    // автобус на ребро — один раз
+    const size_t first_equivalent = equivalent_buses_.size();
+    for (uint32_t i = 0; i < edges.size(); ++i) {
+        if (kept[i] != DROPPED && kept[i] != i) {
+            equivalent_buses_.push_back({edge_ids[kept[i]], edges[i]->bus_ptr, edges[i]->span_count});
+        }
+    }
+    std::stable_sort(equivalent_buses_.begin() + first_equivalent, equivalent_buses_.end(),
+                     [](const EquivalentBus& lhs, const EquivalentBus& rhs) {
+                         return lhs.edge_id < rhs.edge_id;
+                     });
+    const auto duplicates = std::unique(
+        equivalent_buses_.begin() + first_equivalent, equivalent_buses_.end(),
+        [](const EquivalentBus& lhs, const EquivalentBus& rhs) {
+            return lhs.edge_id == rhs.edge_id && lhs.bus == rhs.bus;
+        });
+    equivalent_buses_.erase(duplicates, equivalent_buses_.end());
+    const auto same_bus = std::remove_if(
+        equivalent_buses_.begin() + first_equivalent, equivalent_buses_.end(),
+        [this](const EquivalentBus& equivalent) {
+            return edge_info_[equivalent.edge_id].bus_ptr == equivalent.bus;
+        });
+    equivalent_buses_.erase(same_bus, equivalent_buses_.end());
+}
+
+void TransportRouter::RestoreDroppedEdges(const std::vector<graph::EdgeId>& removed_edges,
+                                          const std::vector<std::string_view>& names) {
+    // Удалённое ребро без равноценного автобуса могло вытеснить при построении
+    // более длинные рёбра других автобусов между теми же вершинами. Они строятся
+    // заново для автобусов, проходящих через начальные остановки удалённых рёбер
+    std::vector<std::pair<graph::VertexId, graph::VertexId>> pairs;
+    std::vector<const domain::Bus*> buses;
+    for (const graph::EdgeId edge_id : removed_edges) {
+        const ExtendedEdge& edge = edge_info_[edge_id];
+        pairs.emplace_back(edge.from, edge.to);
+        for (const domain::Bus* bus : catalogue_.GetBusesForStop(vertex_to_stop_[edge.from]->id)) {
+            if (!std::binary_search(names.begin(), names.end(), bus->name)) {
+                buses.push_back(bus);
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    std::sort(buses.begin(), buses.end(), detail::BusPtrCompare{});
+    buses.erase(std::unique(buses.begin(), buses.end()), buses.end());
+
+    std::vector<ExtendedEdge> bus_edges;
+    std::vector<ExtendedEdge> restored;
+    for (const domain::Bus* bus : buses) {
+        bus_edges.clear();
+        MakeBusEdges(bus, bus_edges);
+        for (const ExtendedEdge& edge : bus_edges) {
+            if (std::binary_search(pairs.begin(), pairs.end(), std::pair{edge.from, edge.to})) {
+                restored.push_back(edge);
+            }
+        }
+    }
+
+    std::vector<const ExtendedEdge*> edges;
+    edges.reserve(restored.size());
+    for (const ExtendedEdge& edge : restored) {
+        edges.push_back(&edge);
+    }
+    // Восстанавливаемых рёбер немного, дополнительные потоки не нужны
+    parallel::ThreadPool pool(1);
+    AddDedupedEdges(edges, pool);
+}
+
+void TransportRouter::MakeBusEdges(const domain::Bus* bus, std::vector<ExtendedEdge>& edges) const {
     if (!bus || bus->stops.size() < 2) {
         return;
     }
-    
+
+    // Накопленные расстояния по дороге от первой остановки в прямом направлении
+    // и в обратном (от stops[k] назад к первой), а также число перегонов без
+    // заданного расстояния. Отрезок i -> j допустим, если на нём нет таких
+    // перегонов, и его длина — разность накопленных расстояний.
+    // Суммы целых точны, поэтому время совпадает с поэлементным сложением
+    const size_t size = bus->stops.size();
+    std::vector<int64_t> forward(size, 0);
+    std::vector<int64_t> backward(size, 0);
+    std::vector<uint32_t> forward_gaps(size, 0);
+    std::vector<uint32_t> backward_gaps(size, 0);
+    for (size_t k = 0; k + 1 < size; ++k) {
+        const int dist = catalogue_.GetDistance(bus->stops[k], bus->stops[k + 1]);
+        forward[k + 1] = forward[k] + dist;
+        forward_gaps[k + 1] = forward_gaps[k] + (dist == 0);
+        if (!bus->is_roundtrip) {
+            const int back_dist = catalogue_.GetDistance(bus->stops[k + 1], bus->stops[k]);
+            backward[k + 1] = backward[k] + back_dist;
+            backward_gaps[k + 1] = backward_gaps[k] + (back_dist == 0);
+        }
+    }
+
+    std::vector<graph::VertexId> stop_vertices(size);
+    for (size_t k = 0; k < size; ++k) {
+        stop_vertices[k] = GetStopVertex(bus->stops[k]);
+    }
+
     // Для каждой пары остановок на маршруте (i -> j, где j > i)
-    for (size_t i = 0; i < bus->stops.size(); ++i) {
-        for (size_t j = i + 1; j < bus->stops.size(); ++j) {
-            // Вычисляем общее расстояние между остановками i и j
-            double total_distance = 0.0;
-            bool valid = true;
-            
-            for (size_t k = i; k < j; ++k) {
-                const auto* from_stop = bus->stops[k];
-                const auto* to_stop = bus->stops[k + 1];
-                
-                // Пробуем получить расстояние в прямом направлении
-                int dist = catalogue_.GetDistance(from_stop, to_stop);
-                if (dist == 0) {
-                    // Если нет расстояния, этот сегмент невалиден
-                    valid = false;
-                    break;
-                }
-                total_distance += dist;
-            }
-            
-            if (!valid || total_distance <= 0) {
+    for (size_t i = 0; i < size; ++i) {
+        for (size_t j = i + 1; j < size; ++j) {
+            const int total_distance = static_cast<int>(forward[j] - forward[i]);
+            if (forward_gaps[j] != forward_gaps[i] || total_distance <= 0) {
                 continue;
             }
-            
-            // Вычисляем время поездки в минутах
-            // скорость в км/ч * 1000 / 60 = скорость в метрах в минуту
-            double speed_m_per_min = settings_.bus_velocity * 1000.0 / 60.0;
-            double time = total_distance / speed_m_per_min;
-            int span_count = static_cast<int>(j - i);
-            
-            // Добавляем ребро от i к j
-            const auto* from_stop = bus->stops[i];
-            const auto* to_stop = bus->stops[j];
-            
-            graph::Edge<double> bus_edge{
-                stop_to_vertex_.at(from_stop) + 1,  // from - вершина посадки
-                stop_to_vertex_.at(to_stop),        // to - вершина ожидания
-                time
-            };
-            
-            auto edge_id = graph_->AddEdge(bus_edge);
-            edge_info_[edge_id] = {stop_to_vertex_.at(from_stop) + 1,
-                                  stop_to_vertex_.at(to_stop),
-                                  time,
-                                  bus,
-                                  span_count,
-                                  false};
-            
+            edges.push_back({stop_vertices[i],
+                             stop_vertices[j],
+                             GetEdgeWeight(EdgeKind::BUS, total_distance, settings_),
+                             bus,
+                             static_cast<int>(j - i),
+                             EdgeKind::BUS,
+                             total_distance});
+
             // Для кольцевого маршрута, если это последний сегмент, добавляем ребро замыкания
-            if (bus->is_roundtrip && i == 0 && j == bus->stops.size() - 1) {
-                // Добавляем ребро от последней остановки к первой
-                double circle_distance = 0.0;
-                valid = true;
-                
-                // Вычисляем расстояние от последней к первой
-                const auto* last_stop = bus->stops.back();
-                const auto* first_stop = bus->stops.front();
-                int dist = catalogue_.GetDistance(last_stop, first_stop);
-                if (dist == 0) {
-                    valid = false;
-                } else {
-                    circle_distance = dist;
-                }
-                
-                if (valid && circle_distance > 0) {
-                    double circle_time = circle_distance / speed_m_per_min;
-                    
-                    graph::Edge<double> circle_edge{
-                        stop_to_vertex_.at(last_stop) + 1,
-                        stop_to_vertex_.at(first_stop),
-                        circle_time
-                    };
-                    
-                    auto circle_edge_id = graph_->AddEdge(circle_edge);
-                    edge_info_[circle_edge_id] = {stop_to_vertex_.at(last_stop) + 1,
-                                                 stop_to_vertex_.at(first_stop),
-                                                 circle_time,
-                                                 bus,
-                                                 1,
-                                                 false};
+            if (bus->is_roundtrip && i == 0 && j == size - 1) {
+                const int circle_distance = catalogue_.GetDistance(bus->stops.back(),
+                                                                   bus->stops.front());
+                if (circle_distance > 0) {
+                    edges.push_back({stop_vertices.back(),
+                                     stop_vertices.front(),
+                                     GetEdgeWeight(EdgeKind::BUS, circle_distance, settings_),
+                                     bus,
+                                     1,
+                                     EdgeKind::BUS,
+                                     circle_distance});
                 }
             }
         }
     }
-    
-    // Для некольцевого маршрута добавляем обратные рёбра
+
+    // Для некольцевого маршрута добавляем обратные рёбра (от конечной к начальной)
     if (!bus->is_roundtrip) {
-        // Обратное направление (от конечной к начальной)
-        for (size_t i = bus->stops.size() - 1; i > 0; --i) {
+        for (size_t i = size - 1; i > 0; --i) {
             for (size_t j = i - 1; j != static_cast<size_t>(-1); --j) {
-                // Вычисляем расстояние в обратном направлении
-                double total_distance = 0.0;
-                bool valid = true;
-                
-                for (size_t k = i; k > j; --k) {
-                    const auto* from_stop = bus->stops[k];
-                    const auto* to_stop = bus->stops[k - 1];
-                    
-                    int dist = catalogue_.GetDistance(from_stop, to_stop);
-                    if (dist == 0) {
-                        valid = false;
-                        break;
-                    }
-                    total_distance += dist;
-                }
-                
-                if (!valid || total_distance <= 0) {
+                const int total_distance = static_cast<int>(backward[i] - backward[j]);
+                if (backward_gaps[i] != backward_gaps[j] || total_distance <= 0) {
                     continue;
                 }
-                
-                // Вычисляем время поездки
-                double speed_m_per_min = settings_.bus_velocity * 1000.0 / 60.0;
-                double time = total_distance / speed_m_per_min;
-                int span_count = static_cast<int>(i - j);
-                
-                // Добавляем ребро
-                const auto* from_stop = bus->stops[i];
-                const auto* to_stop = bus->stops[j];
-                
-                graph::Edge<double> bus_edge{
-                    stop_to_vertex_.at(from_stop) + 1,
-                    stop_to_vertex_.at(to_stop),
-                    time
-                };
-                
-                auto edge_id = graph_->AddEdge(bus_edge);
-                edge_info_[edge_id] = {stop_to_vertex_.at(from_stop) + 1,
-                                      stop_to_vertex_.at(to_stop),
-                                      time,
-                                      bus,
-                                      span_count,
-                                      false};
+                edges.push_back({stop_vertices[i],
+                                 stop_vertices[j],
+                                 GetEdgeWeight(EdgeKind::BUS, total_distance, settings_),
+                                 bus,
+                                 static_cast<int>(i - j),
+                                 EdgeKind::BUS,
+                                 total_distance});
             }
         }
     }
 }
 
+void TransportRouter::AddRideEdgesForPattern(const RidePattern& pattern,
+                                             graph::VertexId first_ride_vertex) {
+    // Ожидание входит в вес посадки, выход бесплатен,
+    // время поездки набирается перегонами между вершинами поездки
+    const size_t size = pattern.stops.size();
+    for (size_t i = 0; i < size; ++i) {
+        const graph::VertexId ride_vertex = first_ride_vertex + i;
+        const graph::VertexId stop_vertex = GetStopVertex(pattern.stops[i]);
+        vertex_to_stop_[ride_vertex] = pattern.stops[i];
+
+        if (i > 0) {
+            const int distance = pattern.distances[i - 1];
+            AddEdge({ride_vertex - 1, ride_vertex, GetEdgeWeight(EdgeKind::RIDE, distance, settings_),
+                     pattern.bus, 1, EdgeKind::RIDE, distance});
+            AddEdge({ride_vertex, stop_vertex, GetEdgeWeight(EdgeKind::ALIGHT, 0, settings_),
+                     pattern.bus, 0, EdgeKind::ALIGHT});
+        }
+        if (i + 1 < size) {
+            AddEdge({stop_vertex, ride_vertex, GetEdgeWeight(EdgeKind::BOARD, 0, settings_),
+                     pattern.bus, 0, EdgeKind::BOARD});
+        }
+    }
+}
+
+double TransportRouter::GetEdgeWeight(EdgeKind kind, int distance,
+                                      const domain::RouteSettings& settings) {
+    // скорость в км/ч * 1000 / 60 = скорость в метрах в минуту
+    const double speed_m_per_min = settings.bus_velocity * 1000.0 / 60.0;
+    switch (kind) {
+    case EdgeKind::BUS:
+        return settings.bus_wait_time + distance / speed_m_per_min;
+    case EdgeKind::BOARD:
+        return static_cast<double>(settings.bus_wait_time);
+    case EdgeKind::RIDE:
+        return distance / speed_m_per_min;
+    case EdgeKind::ALIGHT:
+        break;
+    }
+    return 0.0;
+}
+
+void TransportRouter::AddEdge(const ExtendedEdge& edge) {
+    graph_->AddEdge({edge.from, edge.to, edge.weight});
+    edge_info_.push_back(edge);
+}
+
+graph::VertexId TransportRouter::GetStopVertex(const domain::Stop* stop) const {
+    return stop->id < stop_to_vertex_.size() ? stop_to_vertex_[stop->id] : NO_VERTEX;
+}
+
 std::optional<RouteData> TransportRouter::BuildRoute(std::string_view from, 
                                                      std::string_view to) const {
-    RouteData result;
-    
     auto from_stop = catalogue_.GetStop(from);
     auto to_stop = catalogue_.GetStop(to);
-    
+    if (!from_stop || !to_stop || !answer_cache_) {
+        return FindRoute(from_stop, to_stop);
+    }
+    return *BuildSharedRoute(from, to);
+}
+
+TransportRouter::SharedRoute TransportRouter::BuildSharedRoute(std::string_view from,
+                                                               std::string_view to) const {
+    auto from_stop = catalogue_.GetStop(from);
+    auto to_stop = catalogue_.GetStop(to);
+    if (!from_stop || !to_stop || !answer_cache_) {
+        return std::make_shared<const std::optional<RouteData>>(FindRoute(from_stop, to_stop));
+    }
+
+    // Повторный запрос не проходит ни поиск, ни сборку элементов маршрута
+    const AnswerKey key = static_cast<AnswerKey>(from_stop->id) << 32 | to_stop->id;
+    const uint64_t version = catalogue_.GetVersion();
+    if (auto answer = answer_cache_->Find(key, version)) {
+        return std::move(*answer);
+    }
+    auto answer = std::make_shared<const std::optional<RouteData>>(FindRoute(from_stop, to_stop));
+    answer_cache_->Insert(key, version, answer);
+    return answer;
+}
+
+std::optional<Minutes> TransportRouter::GetRouteTime(std::string_view from,
+                                                     std::string_view to) const {
+    if (!hub_label_router_) {
+        const auto route = BuildRoute(from, to);
+        return route ? std::optional(route->total_time) : std::nullopt;
+    }
+    std::shared_lock lock(search_mutex_);
+
+    const auto* from_stop = catalogue_.GetStop(from);
+    const auto* to_stop = catalogue_.GetStop(to);
+    if (!from_stop || !to_stop) {
+        return std::nullopt;
+    }
+    const graph::VertexId from_vertex = GetStopVertex(from_stop);
+    const graph::VertexId to_vertex = GetStopVertex(to_stop);
+    if (from_vertex == NO_VERTEX || to_vertex == NO_VERTEX) {
+        const auto route = MakeEmptyRoute(from_stop, to_stop);
+        return route ? std::optional(route->total_time) : std::nullopt;
+    }
+    if (!components_.IsConnected(from_vertex, to_vertex)) {
+        return std::nullopt;
+    }
+    const auto weight = hub_label_router_->GetWeight(from_vertex, to_vertex);
+    return weight ? std::optional(Minutes(*weight)) : std::nullopt;
+}
+
+std::optional<RouteData> TransportRouter::FindRoute(const domain::Stop* from_stop,
+                                                    const domain::Stop* to_stop) const {
+    std::shared_lock lock(search_mutex_);
+    if (from_stop && to_stop && raptor_) {
+        auto journey = raptor_->BuildJourney(from_stop, to_stop);
+        if (!journey) {
+            return std::nullopt;
+        }
+        return MakeRouteData(*journey, true, settings_);
+    }
+
     if (!from_stop || !to_stop || !router_) {
         return std::nullopt;
     }
     
-    auto from_vertex = stop_to_vertex_.at(from_stop);
-    auto to_vertex = stop_to_vertex_.at(to_stop);
+    auto from_vertex = GetStopVertex(from_stop);
+    auto to_vertex = GetStopVertex(to_stop);
+    if (from_vertex == NO_VERTEX || to_vertex == NO_VERTEX) {
+        return MakeEmptyRoute(from_stop, to_stop);
+    }
+    // Между компонентами графа маршрута нет, поиск не нужен
+    if (!components_.IsConnected(from_vertex, to_vertex)) {
+        return std::nullopt;
+    }
     
     auto route_info = router_->BuildRoute(from_vertex, to_vertex);
     
@@ -221,41 +1451,315 @@ std::optional<RouteData> TransportRouter::BuildRoute(std::string_view from,
         return std::nullopt;
     }
     
-    result.total_time = Minutes(route_info->weight);
-    
-    for (auto edge_id : route_info->edges) {
-        const auto& edge = edge_info_.at(edge_id);
-        
-        if (edge.is_wait) {
-            // Это ребро ожидания
-            const domain::Stop* stop = nullptr;
-            for (const auto& [s, v] : stop_to_vertex_) {
-                if (v == edge.from) {
-                    stop = s;
-                    break;
+    return MakeRouteData(*route_info, true, settings_);
+}
+
+std::optional<RouteData> TransportRouter::BuildRoute(std::string_view from, std::string_view to,
+                                                     const domain::RouteSettings& settings) const {
+    if (settings.bus_wait_time == settings_.bus_wait_time
+        && settings.bus_velocity == settings_.bus_velocity) {
+        return BuildRoute(from, to);
+    }
+    if (settings.bus_wait_time < 0 || !(settings.bus_velocity > 0)) {
+        throw std::invalid_argument("Invalid routing settings override");
+    }
+    std::shared_lock lock(search_mutex_);
+
+    const auto* from_stop = catalogue_.GetStop(from);
+    const auto* to_stop = catalogue_.GetStop(to);
+    if (!from_stop || !to_stop || (!router_ && !raptor_)) {
+        return std::nullopt;
+    }
+
+    if (raptor_) {
+        auto journey = raptor_->BuildJourney(from_stop, to_stop, settings);
+        if (!journey) {
+            return std::nullopt;
+        }
+        return MakeRouteData(*journey, true, settings);
+    }
+
+    const graph::VertexId from_vertex = GetStopVertex(from_stop);
+    const graph::VertexId to_vertex = GetStopVertex(to_stop);
+    if (from_vertex == NO_VERTEX || to_vertex == NO_VERTEX) {
+        return MakeEmptyRoute(from_stop, to_stop);
+    }
+    if (!components_.IsConnected(from_vertex, to_vertex)) {
+        return std::nullopt;
+    }
+    const auto edge_weight = [this, &settings](graph::EdgeId edge_id) {
+        const ExtendedEdge& edge = edge_info_[edge_id];
+        return GetEdgeWeight(edge.kind, edge.distance, settings);
+    };
+    std::optional<graph::RouterBase<double>::RouteInfo> route_info;
+    if (overlay_router_) {
+        // Разбиение не зависит от весов: для новых настроек повторяется только
+        // настройка клик, и метрика переиспользуется, пока настройки те же
+        std::shared_ptr<const OverlayMetricEntry> metric;
+        {
+            std::lock_guard guard(overlay_metric_mutex_);
+            if (!overlay_metric_
+                || overlay_metric_->first.bus_wait_time != settings.bus_wait_time
+                || overlay_metric_->first.bus_velocity != settings.bus_velocity) {
+                overlay_metric_ = std::make_shared<const OverlayMetricEntry>(
+                    settings, overlay_router_->Customize(edge_weight));
+            }
+            metric = overlay_metric_;
+        }
+        route_info = overlay_router_->BuildRoute(from_vertex, to_vertex, metric->second);
+    } else {
+        route_info = GetBatchRouter().BuildRoute(from_vertex, to_vertex, edge_weight);
+    }
+    if (!route_info) {
+        return std::nullopt;
+    }
+    return MakeRouteData(*route_info, true, settings);
+}
+
+RouteMatrix TransportRouter::BuildRoutes(const std::vector<std::string_view>& from,
+                                         const std::vector<std::string_view>& to,
+                                         bool with_items) const {
+    RouteMatrix matrix(from.size(), std::vector<std::optional<RouteData>>(to.size()));
+    std::shared_lock lock(search_mutex_);
+    if (!router_ && !raptor_) {
+        return matrix;
+    }
+
+    // Неизвестные остановки остаются без маршрута
+    std::vector<size_t> target_columns;
+    std::vector<const domain::Stop*> target_stops;
+    for (size_t column = 0; column < to.size(); ++column) {
+        if (const auto* stop = catalogue_.GetStop(to[column])) {
+            target_columns.push_back(column);
+            target_stops.push_back(stop);
+        }
+    }
+
+    if (raptor_) {
+        // Один поиск RAPTOR из источника сразу даёт время до всех остановок
+        for (size_t row = 0; row < from.size(); ++row) {
+            const auto* from_stop = catalogue_.GetStop(from[row]);
+            if (!from_stop) {
+                continue;
+            }
+            const auto journeys = raptor_->BuildJourneys(from_stop, target_stops);
+            for (size_t i = 0; i < journeys.size(); ++i) {
+                if (journeys[i]) {
+                    matrix[row][target_columns[i]] = MakeRouteData(*journeys[i], with_items,
+                                                                   settings_);
+                }
+            }
+        }
+        return matrix;
+    }
+
+    // Остановки без автобусов ищутся только среди источников: до них маршрута нет
+    std::vector<size_t> vertex_columns;
+    std::vector<graph::VertexId> target_vertices;
+    for (size_t i = 0; i < target_stops.size(); ++i) {
+        if (const graph::VertexId vertex = GetStopVertex(target_stops[i]); vertex != NO_VERTEX) {
+            vertex_columns.push_back(target_columns[i]);
+            target_vertices.push_back(vertex);
+        }
+    }
+
+    // Таблицы всех пар и метки хабов отвечают на пару без поиска Дейкстры,
+    // иначе из каждого источника выполняется один поиск сразу до всех целей
+    const bool has_table = options_.type == RouterType::ALL_PAIRS
+                           || options_.type == RouterType::COMPACT_ALL_PAIRS
+                           || options_.type == RouterType::HUB_LABELS;
+
+    std::vector<size_t> row_columns;
+    std::vector<graph::VertexId> row_vertices;
+
+    for (size_t row = 0; row < from.size(); ++row) {
+        const auto* from_stop = catalogue_.GetStop(from[row]);
+        if (!from_stop) {
+            continue;
+        }
+        const graph::VertexId from_vertex = GetStopVertex(from_stop);
+        if (from_vertex == NO_VERTEX) {
+            for (size_t i = 0; i < target_stops.size(); ++i) {
+                matrix[row][target_columns[i]] = MakeEmptyRoute(from_stop, target_stops[i]);
+            }
+            continue;
+        }
+
+        // Цели из других компонент графа недостижимы: поиск до них не ведётся
+        // и не обходит из-за них всю компоненту источника
+        row_columns.clear();
+        row_vertices.clear();
+        for (size_t i = 0; i < target_vertices.size(); ++i) {
+            if (components_.IsConnected(from_vertex, target_vertices[i])) {
+                row_columns.push_back(vertex_columns[i]);
+                row_vertices.push_back(target_vertices[i]);
+            }
+        }
+
+        // Без элементов метки хабов сразу дают время
+        if (hub_label_router_ && !with_items) {
+            for (size_t i = 0; i < row_vertices.size(); ++i) {
+                if (const auto weight = hub_label_router_->GetWeight(from_vertex, row_vertices[i])) {
+                    matrix[row][row_columns[i]] = RouteData{Minutes(*weight), {}};
                 }
             }
-            
-            if (stop) {
-                domain::WaitItem wait_item{
-                    stop->name,
-                    edge.weight
-                };
-                result.items.push_back(wait_item);
+            continue;
+        }
+
+        std::vector<std::optional<graph::RouterBase<double>::RouteInfo>> routes;
+        if (has_table) {
+            routes.reserve(row_vertices.size());
+            for (const graph::VertexId to_vertex : row_vertices) {
+                routes.push_back(router_->BuildRoute(from_vertex, to_vertex));
             }
         } else {
-            // Это ребро поездки на автобусе
-            if (edge.bus_ptr) {
-                domain::BusItem bus_item{
+            routes = GetBatchRouter().BuildRoutes(from_vertex, row_vertices);
+        }
+
+        for (size_t i = 0; i < routes.size(); ++i) {
+            if (routes[i]) {
+                matrix[row][row_columns[i]] = MakeRouteData(*routes[i], with_items, settings_);
+            }
+        }
+    }
+    return matrix;
+}
+
+std::vector<ReachableStop> TransportRouter::FindReachable(std::string_view from,
+                                                         Minutes max_time) const {
+    std::vector<ReachableStop> result;
+    std::shared_lock lock(search_mutex_);
+    const auto* from_stop = catalogue_.GetStop(from);
+    if (!from_stop || (!router_ && !raptor_)) {
+        return result;
+    }
+
+    if (raptor_) {
+        // У RAPTOR нет отсечения по времени: поиск до всех остановок с фильтром
+        std::vector<const domain::Stop*> stops;
+        stops.reserve(catalogue_.GetStopCount());
+        for (domain::StopId id = 0; id < catalogue_.GetStopCount(); ++id) {
+            stops.push_back(catalogue_.GetStopById(id));
+        }
+        const auto journeys = raptor_->BuildJourneys(from_stop, stops);
+        for (size_t i = 0; i < stops.size(); ++i) {
+            if (journeys[i] && journeys[i]->total_time <= max_time.count()) {
+                result.push_back({stops[i], Minutes(journeys[i]->total_time)});
+            }
+        }
+    } else if (const graph::VertexId from_vertex = GetStopVertex(from_stop);
+               from_vertex == NO_VERTEX) {
+        result.push_back({from_stop, Minutes(0)});
+    } else {
+        // Остановка достигнута, когда извлечена её вершина
+        const auto reachable = GetBatchRouter().FindReachable(from_vertex, max_time.count());
+        for (const auto& [vertex, time] : reachable) {
+            const domain::Stop* stop = vertex_to_stop_[vertex];
+            if (stop_to_vertex_[stop->id] == vertex) {
+                result.push_back({stop, Minutes(time)});
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const ReachableStop& lhs, const ReachableStop& rhs) {
+        return std::tie(lhs.time, lhs.stop->name) < std::tie(rhs.time, rhs.stop->name);
+    });
+    return result;
+}
+
+const graph::DijkstraRouter<double>& TransportRouter::GetBatchRouter() const {
+    return *batch_router_;
+}
+
+RouteData TransportRouter::MakeRouteData(const graph::RouterBase<double>::RouteInfo& route_info,
+                                         bool with_items,
+                                         const domain::RouteSettings& settings) const {
+    RouteData result;
+    
+    // Ребро BUS и ребро BOARD включают ожидание на остановке, с которой они
+    // выходят: оно выдаётся отдельным WaitItem перед BusItem. В LINEAR_RIDES
+    // поездка — цепочка BOARD, RIDE..., ALIGHT, которая сворачивается в один
+    // BusItem со временем по сумме расстояний, как у ребра SPAN_EDGES. Общее время
+    // складывается из времени элементов, чтобы ответ не зависел от модели графа
+    // и порядка сложения весов в маршрутизаторе
+    const double wait_time = static_cast<double>(settings.bus_wait_time);
+    double total_time = 0.0;
+    int ride_distance = 0;
+    int ride_span_count = 0;
+    for (auto edge_id : route_info.edges) {
+        const auto& edge = edge_info_[edge_id];
+        
+        switch (edge.kind) {
+        case EdgeKind::BUS: {
+            const double ride_time = GetEdgeWeight(EdgeKind::RIDE, edge.distance, settings);
+            total_time += wait_time;
+            total_time += ride_time;
+            if (edge.bus_ptr && with_items) {
+                result.items.push_back(domain::WaitItem{
+                    vertex_to_stop_[edge.from]->name,
+                    wait_time
+                });
+                result.items.push_back(domain::BusItem{
                     edge.bus_ptr->name,
                     edge.span_count,
-                    edge.weight
-                };
-                result.items.push_back(bus_item);
+                    ride_time
+                });
             }
+            break;
+        }
+        case EdgeKind::BOARD:
+            total_time += wait_time;
+            if (with_items) {
+                result.items.push_back(domain::WaitItem{
+                    vertex_to_stop_[edge.from]->name,
+                    wait_time
+                });
+            }
+            ride_distance = 0;
+            ride_span_count = 0;
+            break;
+        case EdgeKind::RIDE:
+            ride_distance += edge.distance;
+            ride_span_count += edge.span_count;
+            break;
+        case EdgeKind::ALIGHT: {
+            const double ride_time = GetEdgeWeight(EdgeKind::RIDE, ride_distance, settings);
+            total_time += ride_time;
+            if (with_items) {
+                result.items.push_back(domain::BusItem{
+                    edge.bus_ptr->name,
+                    ride_span_count,
+                    ride_time
+                });
+            }
+            break;
+        }
         }
     }
     
+    result.total_time = Minutes(total_time);
+    return result;
+}
+
+RouteData TransportRouter::MakeRouteData(const RaptorJourney& journey, bool with_items,
+                                         const domain::RouteSettings& settings) const {
+    RouteData result;
+    result.total_time = Minutes(journey.total_time);
+    if (!with_items) {
+        return result;
+    }
+
+    for (const auto& leg : journey.legs) {
+        result.items.push_back(domain::WaitItem{
+            leg.board_stop->name,
+            static_cast<double>(settings.bus_wait_time)
+        });
+        result.items.push_back(domain::BusItem{
+            leg.bus->name,
+            leg.span_count,
+            leg.ride_time
+        });
+    }
     return result;
 }
 
@@ -1,14 +1,32 @@
 #pragma once
 
 #include <string>
-#include <unordered_map>
+#include <limits>
 #include <memory>
 #include <chrono>
 #include <optional>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
 #include "domain.h"
 #include "graph.h"
 #include "router.h"
+#include "compact_router.h"
+#include "component_router.h"
+#include "dijkstra_router.h"
+#include "bidirectional_router.h"
+#include "astar_router.h"
+#include "alt_router.h"
+#include "hub_labels.h"
+#include "overlay_router.h"
+#include "contraction_hierarchy.h"
+#include "tree_cache_router.h"
+#include "raptor_router.h"
+#include "ride_patterns.h"
+#include "thread_pool.h"
 #include "transport_catalogue.h"
+#include "mapped_file.h"
+#include "clock_cache.h"
 
 namespace transport_catalogue {
 
@@ -19,32 +37,289 @@ struct RouteData {
     std::vector<std::variant<domain::WaitItem, domain::BusItem>> items;
 };
 
+// Маршруты из каждого источника (строка) в каждую цель (столбец); nullopt — маршрута нет
+using RouteMatrix = std::vector<std::vector<std::optional<RouteData>>>;
+
+struct ReachableStop {
+    const domain::Stop* stop = nullptr;
+    Minutes time;
+};
+
+// Алгоритм поиска маршрута, выбираемый при создании TransportRouter
+enum class RouterType {
+    ALL_PAIRS,              // предрасчёт всех пар (Флойд–Уоршелл или V поисков Дейкстры), быстрые запросы
+    COMPACT_ALL_PAIRS,      // то же в плоской таблице float + 32-битное ребро, в ~4 раза меньше памяти
+    DIJKSTRA,               // поиск Дейкстры на каждый запрос, без предрасчёта
+    BIDIRECTIONAL,          // двунаправленный поиск Дейкстры, без предрасчёта
+    ASTAR,                  // A* с оценкой по координатам остановок, без предрасчёта
+    CONTRACTION_HIERARCHY,  // иерархия стягивания: предрасчёт shortcut, быстрые запросы
+    ALT,                    // A* с оценками по ориентирам: предрасчёт O(L * V) весов
+    HUB_LABELS,             // метки хабов: время маршрута — слияние двух меток без поиска
+    OVERLAY,                // многоуровневый оверлей ячеек: другие настройки — только пересчёт клик
+    RAPTOR                  // поиск по раундам прямо по маршрутам автобусов, без графа
+};
+
+// Устройство графа для маршрутизаторов, работающих с графом
+enum class GraphModel {
+    SPAN_EDGES,   // ребро для каждой пары остановок маршрута: O(k^2) рёбер на автобус
+    LINEAR_RIDES  // вершина на каждую остановку каждого отрезка маршрута: O(k) рёбер
+};
+
+struct RouterOptions {
+    // По умолчанию — поиск без предрасчёта, чтобы сервис отвечал сразу после запуска
+    RouterType type = RouterType::BIDIRECTIONAL;
+    // Бюджет памяти в байтах для кэша деревьев кратчайших путей (LRU по источникам).
+    // 0 — кэш отключён. Используется только с RouterType::DIJKSTRA
+    size_t tree_cache_bytes = 0;
+    // Число потоков построения рёбер автобусов, предрасчёта таблиц всех пар
+    // и их обновления в UpdateBus; 0 — по числу ядер
+    size_t precompute_threads = 0;
+    // Способ предрасчёта таблиц всех пар; AUTO выбирает Дейкстру для разреженного графа
+    graph::AllPairsMethod all_pairs_method = graph::AllPairsMethod::AUTO;
+    // Файл кэша графа и таблиц маршрутизатора. Если файл построен для того же
+    // справочника и настроек и его контрольная сумма сошлась, он отображается
+    // в память вместо предрасчёта, иначе после построения записывается заново.
+    // Пустой путь — кэш не используется
+    std::string cache_path;
+    // Для LINEAR_RIDES граф меньше, но маршрут в нём проходит больше рёбер;
+    // ответы совпадают с SPAN_EDGES
+    GraphModel graph_model = GraphModel::SPAN_EDGES;
+    // Для SPAN_EDGES из рёбер с общими начальной и конечной вершинами остаётся
+    // только самое короткое: остальные не могут дать более быстрый маршрут.
+    // Автобусы с тем же расстоянием запоминаются как равноценные
+    bool dedup_parallel_edges = false;
+    // Число ориентиров и способ их выбора для RouterType::ALT
+    size_t landmark_count = 16;
+    graph::LandmarkSelection landmark_selection = graph::LandmarkSelection::AVOID;
+    // Разбиение для RouterType::OVERLAY: вершин в ячейке нижнего уровня и число уровней.
+    // В графе SPAN_EDGES почти все вершины граничные, клики выходят большими:
+    // оверлею лучше подходит LINEAR_RIDES
+    size_t overlay_cell_size = 64;
+    size_t overlay_level_count = 2;
+    // Число ответов BuildRoute, хранимых в кэше по паре остановок (вытеснение CLOCK).
+    // 0 — кэш отключён
+    size_t answer_cache_size = 0;
+    // Пары остановок, ответы для которых строятся и кладутся в кэш при создании
+    std::vector<std::pair<std::string, std::string>> answer_cache_warm_up;
+};
+
+// Запросы можно вызывать из нескольких потоков, они идут параллельно: каждый
+// поиск берёт рабочие массивы из пула своего маршрутизатора. По очереди
+// проходят только изменения общих кэшей — деревьев, ответов и метрики оверлея.
+// UpdateBus ждёт завершения начатых запросов
 class TransportRouter {
 public:
+    // Ответ BuildSharedRoute; пустой optional внутри — маршрута нет
+    using SharedRoute = std::shared_ptr<const std::optional<RouteData>>;
+
     explicit TransportRouter(const TransportCatalogue& catalogue, 
-                            const domain::RouteSettings& settings);
+                            const domain::RouteSettings& settings,
+                            const RouterOptions& options = {});
     
     std::optional<RouteData> BuildRoute(std::string_view from, std::string_view to) const;
+
+    // То же без копирования ответа: попадание в кэш ответов отдаёт саму запись
+    // кэша, и элементы маршрута с названиями не копируются
+    SharedRoute BuildSharedRoute(std::string_view from, std::string_view to) const;
+
+    // Маршрут при других настройках (например, меньшей скорости в час пик) по тому
+    // же графу: рёбра хранят расстояния, и веса для settings считаются при поиске
+    // Дейкстры, без перестройки. Кэш ответов и таблицы всех пар построены для
+    // настроек роутера и используются, только если settings с ними совпадают
+    std::optional<RouteData> BuildRoute(std::string_view from, std::string_view to,
+                                        const domain::RouteSettings& settings) const;
+
+    // Только время маршрута; nullopt — маршрута нет. С HUB_LABELS отвечает по
+    // меткам без поиска и сборки элементов, иначе равно BuildRoute(...)->total_time
+    std::optional<Minutes> GetRouteTime(std::string_view from, std::string_view to) const;
+
+    // Маршруты из нескольких остановок в несколько остановок: каждый источник
+    // обрабатывается одним поиском до всех целей. Без with_items заполняется
+    // только общее время
+    RouteMatrix BuildRoutes(const std::vector<std::string_view>& from,
+                            const std::vector<std::string_view>& to,
+                            bool with_items) const;
+
+    // Остановки, до которых можно доехать из from не дольше чем за max_time,
+    // вместе с самой from, по возрастанию времени (при равном — по имени).
+    // Один поиск Дейкстры, остановленный на первой вершине дальше max_time
+    std::vector<ReachableStop> FindReachable(std::string_view from, Minutes max_time) const;
+
+    const domain::RouteSettings& GetSettings() const {
+        return settings_;
+    }
+
+    // Статистика кэша ответов; nullopt, если кэш не используется
+    std::optional<cache::ClockCacheStats> GetAnswerCacheStats() const;
+
+    // Статистика кэша деревьев; nullopt, если кэш не используется
+    std::optional<graph::TreeCacheStats> GetTreeCacheStats() const;
+
+    // Число вершин графа, обработанных последним запросом BuildRoute
+    size_t GetLastSettledCount() const;
+
+    // true, если граф и таблицы загружены из файла кэша
+    bool IsLoadedFromCache() const;
+
+    // Учитывает добавление или изменение автобуса name в справочнике без полной
+    // перестройки: рёбра прежней версии автобуса удаляются, новые добавляются,
+    // таблицы всех пар обновляются только для затронутых пар, остальные
+    // маршрутизаторы пересоздаются над изменённым графом. Так же перестраиваются
+    // рёбра автобусов, у которых с прошлого построения или UpdateBus изменилось
+    // расстояние перегона в любую сторону. Файл кэша не обновляется
+    void UpdateBus(std::string_view name);
     
 private:
+    // Ожидание автобуса входит в вес рёбер, выходящих из вершины остановки
+    enum class EdgeKind {
+        BUS,     // ожидание и поездка через span_count перегонов (SPAN_EDGES)
+        BOARD,   // ожидание и посадка с остановки в вершину поездки (LINEAR_RIDES)
+        RIDE,    // один перегон между вершинами поездки (LINEAR_RIDES)
+        ALIGHT   // выход из вершины поездки на остановку (LINEAR_RIDES)
+    };
+
     struct ExtendedEdge {
         graph::VertexId from;
         graph::VertexId to;
         double weight;
         const domain::Bus* bus_ptr = nullptr;
         int span_count = 0;
-        bool is_wait = false;
+        EdgeKind kind = EdgeKind::BUS;
+        int distance = 0;  // метры по дороге для BUS и RIDE
     };
     
+    static constexpr graph::VertexId NO_VERTEX = std::numeric_limits<graph::VertexId>::max();
+
+    using AllPairsComponents = graph::ComponentRouter<double, graph::Router<double>>;
+    using CompactComponents = graph::ComponentRouter<double, graph::CompactRouter<double>>;
+
     void BuildGraph();
+    void AddEdge(const ExtendedEdge& edge);
+    // Вес ребра при настройках settings; weight в ExtendedEdge и в графе —
+    // вес при настройках роутера
+    static double GetEdgeWeight(EdgeKind kind, int distance, const domain::RouteSettings& settings);
+    // NO_VERTEX, если через остановку не идёт ни один автобус
+    graph::VertexId GetStopVertex(const domain::Stop* stop) const;
     void AddBusEdgesForRoute(const domain::Bus* bus);
+    void AddBusEdges(const std::vector<const domain::Bus*>& buses);
+    void AddDedupedEdges(const std::vector<const ExtendedEdge*>& edges, parallel::ThreadPool& pool);
+    // names — обновляемые автобусы по возрастанию, их рёбра не восстанавливаются
+    void RestoreDroppedEdges(const std::vector<graph::EdgeId>& removed_edges,
+                             const std::vector<std::string_view>& names);
+    // Автобусы, у которых после synced_version_ изменилось расстояние перегона
+    std::vector<std::string_view> GetBusesWithChangedDistances() const;
+    void MakeBusEdges(const domain::Bus* bus, std::vector<ExtendedEdge>& edges) const;
+    void AddRideEdgesForPattern(const RidePattern& pattern, graph::VertexId first_ride_vertex);
+    void CreateRouter();
+    // Маршрутизаторы компонент для таблиц всех пар; tables — готовые таблицы
+    // CompactRouter по компонентам, например из файла кэша
+    AllPairsComponents::Factory MakeAllPairsFactory() const;
+    CompactComponents::Factory MakeCompactFactory(
+        std::vector<graph::FlatRouteTable<float>> tables = {}) const;
+    // Таблицы из файла кэша по компонентам; пусто, если кэша нет или разбиение
+    // на компоненты не совпало с сохранённым
+    std::vector<graph::FlatRouteTable<float>> TakeCachedTables();
+    std::optional<RouteData> FindRoute(const domain::Stop* from, const domain::Stop* to) const;
+    const graph::DijkstraRouter<double>& GetBatchRouter() const;
+    void UpdateRouter(const std::vector<graph::EdgeId>& added_edges,
+                      const std::vector<graph::EdgeId>& removed_edges);
+    RouteData MakeRouteData(const graph::RouterBase<double>::RouteInfo& route_info,
+                            bool with_items, const domain::RouteSettings& settings) const;
+    RouteData MakeRouteData(const RaptorJourney& journey, bool with_items,
+                            const domain::RouteSettings& settings) const;
+    bool LoadCache();
+    bool SaveCache() const;
+    uint64_t ComputeCacheKey() const;
+    void PrepareHeuristic();
+    double EstimateTime(graph::VertexId vertex, graph::VertexId target) const;
     
     const TransportCatalogue& catalogue_;
     domain::RouteSettings settings_;
+    RouterOptions options_;
+    // Отображённый файл кэша должен пережить таблицы, которые на него ссылаются
+    io::MappedFile cache_file_;
+    // Таблицы CompactRouter в отображённом файле: по компонентам подряд
+    struct CachedTables {
+        const float* weights = nullptr;
+        const uint32_t* prev_edges = nullptr;
+        size_t table_count = 0;
+        size_t cell_count = 0;
+    };
+    std::optional<CachedTables> cached_tables_;
+    std::optional<graph::HubLabels<double>> cached_labels_;
+    // Разделы загруженного файла, не нужные этому маршрутизатору (таблицы при
+    // HUB_LABELS, метки при COMPACT_ALL_PAIRS). При перезаписи файла они
+    // переносятся в новый, чтобы маршрутизаторы разных типов с общим файлом
+    // не затирали разделы друг друга
+    std::optional<CachedTables> kept_tables_;
+    std::string_view kept_labels_;
+    bool loaded_from_cache_ = false;
     std::unique_ptr<graph::DirectedWeightedGraph<double>> graph_;
-    std::unique_ptr<graph::Router<double>> router_;
-    std::unordered_map<const domain::Stop*, graph::VertexId> stop_to_vertex_;
-    std::unordered_map<graph::EdgeId, ExtendedEdge> edge_info_;
+    std::unique_ptr<graph::RouterBase<double>> router_;
+    const graph::TreeCacheRouter<double>* tree_cache_ = nullptr;
+    graph::Router<double>* all_pairs_router_ = nullptr;
+    graph::CompactRouter<double>* compact_router_ = nullptr;
+    // Таблицы всех пар при нескольких компонентах графа строятся по компонентам
+    AllPairsComponents* component_all_pairs_router_ = nullptr;
+    CompactComponents* component_compact_router_ = nullptr;
+    // Слабо связные компоненты графа: между компонентами маршрута нет,
+    // и такой запрос отвечается без поиска
+    graph::GraphComponents components_;
+    graph::HubLabelRouter<double>* hub_label_router_ = nullptr;
+    graph::OverlayRouter<double>* overlay_router_ = nullptr;
+    // Метрика оверлея для последних настроек BuildRoute, отличных от настроек роутера.
+    // Запрос держит свою копию указателя, пока другие настройки её заменяют
+    using OverlayMetricEntry = std::pair<domain::RouteSettings, graph::OverlayMetric<double>>;
+    mutable std::mutex overlay_metric_mutex_;
+    mutable std::shared_ptr<const OverlayMetricEntry> overlay_metric_;
+    // Поиск до многих целей для BuildRoutes, FindReachable и BuildRoute с другими настройками
+    std::unique_ptr<graph::DijkstraRouter<double>> batch_router_;
+    // Для RouterType::RAPTOR граф не строится
+    std::unique_ptr<RaptorRouter> raptor_;
+    // Вершина остановки по StopId; NO_VERTEX — через остановку не идёт ни один
+    // автобус (или она добавлена в справочник после построения графа)
+    std::vector<graph::VertexId> stop_to_vertex_;
+    // Вершины остановок занимают начало графа в порядке StopId, вершины поездки
+    // LINEAR_RIDES идут следом и отображаются в свою остановку.
+    // Остановки, впервые попавшие в автобус в UpdateBus, получают вершины в конце графа
+    std::vector<const domain::Stop*> vertex_to_stop_;
+
+    // Данные оценки для A*: точки остановок в пространстве (в метрах)
+    // и минуты на метр хорды, не превышающие реальное время в пути
+    struct SpherePoint {
+        double x = 0.0;
+        double y = 0.0;
+        double z = 0.0;
+    };
+    std::vector<SpherePoint> vertex_points_;
+    std::vector<char> is_stop_vertex_;
+    double heuristic_scale_ = 0.0;
+    // Индекс — EdgeId; у удалённых в UpdateBus рёбер bus_ptr сброшен
+    std::vector<ExtendedEdge> edge_info_;
+
+    // Автобус, проходящий между вершинами ребра edge_id с тем же расстоянием,
+    // что и автобус ребра, но не попавший в граф при dedup_parallel_edges
+    struct EquivalentBus {
+        graph::EdgeId edge_id = 0;
+        const domain::Bus* bus = nullptr;
+        int span_count = 0;
+    };
+    // По возрастанию edge_id. Когда UpdateBus удаляет автобус ребра, ребро
+    // остаётся в графе с первым равноценным автобусом
+    std::vector<EquivalentBus> equivalent_buses_;
+    // Версия справочника, изменения расстояний до которой уже учтены в графе
+    uint64_t synced_version_ = 0;
+
+    // Готовые ответы BuildRoute, nullptr внутри — маршрута нет. Версия записей —
+    // версия справочника, UpdateBus очищает кэш целиком
+    // Ключ — пара StopId в одном 64-битном числе
+    using AnswerKey = uint64_t;
+    std::unique_ptr<cache::ClockCache<AnswerKey, SharedRoute>> answer_cache_;
+
+    // Исключительно — UpdateBus, совместно — запросы. Рабочие массивы
+    // маршрутизаторов не выделяются на запрос: на больших графах это V весов
+    // и рёбер на каждый вызов, поэтому они переиспользуются через пулы
+    mutable std::shared_mutex search_mutex_;
 };
 
 } // namespace transport_catalogue
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+struct TreeCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t cached_trees = 0;
+    size_t capacity = 0;
+};
+
+// Слой поверх поиска Дейкстры, хранящий полные деревья кратчайших путей
+// для недавно использованных вершин-источников. Число деревьев ограничено
+// бюджетом памяти, при переполнении вытесняется давно не использованное (LRU).
+// Запрос из закэшированного источника сводится к проходу по дереву.
+// Запросы можно вызывать из нескольких потоков, кэш они изменяют по очереди.
+template <typename Weight>
+class TreeCacheRouter : public RouterBase<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Tree = ShortestPathTree<Weight>;
+
+public:
+    using typename RouterBase<Weight>::RouteInfo;
+
+    TreeCacheRouter(const Graph& graph, size_t memory_budget);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    TreeCacheStats GetStats() const;
+
+private:
+    using LruList = std::list<VertexId>;
+
+    struct CacheEntry {
+        Tree tree;
+        typename LruList::iterator lru_position;
+    };
+
+    const Tree& GetTree(VertexId root) const;
+
+    static constexpr EdgeId NO_EDGE = Tree::NO_EDGE;
+
+    DijkstraRouter<Weight> search_;
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    mutable LruList lru_;  // в начале — последние использованные источники
+    mutable std::unordered_map<VertexId, CacheEntry> trees_;
+    mutable Tree uncached_tree_;  // для бюджета меньше одного дерева
+    mutable size_t hits_ = 0;
+    mutable size_t misses_ = 0;
+};
+
+template <typename Weight>
+TreeCacheRouter<Weight>::TreeCacheRouter(const Graph& graph, size_t memory_budget)
+    : search_(graph)
+{
+    const size_t tree_size = std::max<size_t>(
+        graph.GetVertexCount() * (sizeof(Weight) + sizeof(EdgeId)), 1);
+    capacity_ = memory_budget / tree_size;
+}
+
+template <typename Weight>
+const typename TreeCacheRouter<Weight>::Tree& TreeCacheRouter<Weight>::GetTree(VertexId root) const {
+    if (auto it = trees_.find(root); it != trees_.end()) {
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+        return it->second.tree;
+    }
+
+    ++misses_;
+    if (capacity_ == 0) {
+        search_.BuildTree(root, uncached_tree_);
+        return uncached_tree_;
+    }
+
+    // Память вытесняемого дерева переиспользуется для нового
+    Tree tree;
+    if (trees_.size() >= capacity_) {
+        const VertexId evicted = lru_.back();
+        lru_.pop_back();
+        auto node = trees_.extract(evicted);
+        tree = std::move(node.mapped().tree);
+    }
+    search_.BuildTree(root, tree);
+
+    lru_.push_front(root);
+    auto& entry = trees_[root];
+    entry.tree = std::move(tree);
+    entry.lru_position = lru_.begin();
+    return entry.tree;
+}
+
+template <typename Weight>
+std::optional<typename TreeCacheRouter<Weight>::RouteInfo>
+TreeCacheRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    if (to >= search_.GetGraph().GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    std::lock_guard guard(mutex_);
+    const Tree& tree = GetTree(from);
+    if (!tree.IsReached(to)) {
+        return std::nullopt;
+    }
+
+    const Graph& graph = search_.GetGraph();
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = tree.prev_edges[to]; edge_id != NO_EDGE;
+         edge_id = tree.prev_edges[graph.GetEdge(edge_id).from]) {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{tree.weights[to], std::move(edges)};
+}
+
+template <typename Weight>
+TreeCacheStats TreeCacheRouter<Weight>::GetStats() const {
+    std::lock_guard guard(mutex_);
+    return {hits_, misses_, trees_.size(), capacity_};
+}
+
+}  // namespace graph